@@ -0,0 +1,19 @@
+#ifndef BENCH_BENCHMARKS_HPP
+#define BENCH_BENCHMARKS_HPP
+
+#include "harness.hpp"
+
+namespace bench {
+
+    /// shadow::set() for each of the state transitions with varying thread counts and key skew,
+    /// and the updates of large compilations applied in repository order and in address order
+    /// (as shadow::batch applies them), each with and without prefetching.
+    void shadow_benchmarks (config const & cfg, report & r);
+    /// The Visited sequencer with out-of-order producers.
+    void visited_benchmarks (config const & cfg, report & r);
+    /// Symbol allocation with new_symbol().
+    void symbol_benchmarks (config const & cfg, report & r);
+
+} // end namespace bench
+
+#endif // BENCH_BENCHMARKS_HPP
@@ -0,0 +1,185 @@
+#include "harness.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#if defined(__linux__)
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+namespace {
+
+    void write_string (std::ostream & os, std::string const & s) {
+        os << '"';
+        for (char const c : s) {
+            if (c == '"' || c == '\\') {
+                os << '\\';
+            }
+            os << c;
+        }
+        os << '"';
+    }
+
+    void write_number (std::ostream & os, double const v) {
+        if (v == std::floor (v) && std::abs (v) < 1e15) {
+            os << static_cast<std::int64_t> (v);
+        } else {
+            os << std::setprecision (9) << v;
+        }
+    }
+
+} // end anonymous namespace
+
+namespace bench {
+
+    std::vector<unsigned> config::thread_counts () const {
+        std::vector<unsigned> counts;
+        for (auto t = 1U; t < max_threads; t *= 2U) {
+            counts.push_back (t);
+        }
+        counts.push_back (std::max (max_threads, 1U));
+        return counts;
+    }
+
+    void report::add (measurement m) { results_.push_back (std::move (m)); }
+
+    void report::write (std::ostream & os) const {
+        os << "{\n  \"context\": {\"hardware_concurrency\": "
+           << std::thread::hardware_concurrency () << "},\n  \"benchmarks\": [";
+        auto separator = "\n";
+        for (measurement const & m : results_) {
+            auto const seconds = m.elapsed.count ();
+            os << separator << "    {\"name\": ";
+            write_string (os, m.name);
+            os << ", \"threads\": " << m.threads;
+            for (auto const & param : m.params) {
+                os << ", ";
+                write_string (os, param.first);
+                os << ": ";
+                write_number (os, param.second);
+            }
+            os << ", \"operations\": " << m.operations << ", \"seconds\": ";
+            write_number (os, seconds);
+            os << ", \"ops_per_sec\": ";
+            auto const rate = seconds > 0.0 ? static_cast<double> (m.operations) / seconds : 0.0;
+            write_number (os, std::round (rate));
+            os << '}';
+            separator = ",\n";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    std::chrono::duration<double> run_parallel (unsigned const threads,
+                                                std::function<void (unsigned)> const & fn) {
+        // Hold every thread at a barrier so that thread creation is not part of the measurement.
+        std::atomic<unsigned> ready{0U};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> workers;
+        workers.reserve (threads);
+        for (auto index = 0U; index < threads; ++index) {
+            workers.emplace_back ([&, index] {
+                ready.fetch_add (1U, std::memory_order_acq_rel);
+                while (!go.load (std::memory_order_acquire)) {
+                    std::this_thread::yield ();
+                }
+                fn (index);
+            });
+        }
+        while (ready.load (std::memory_order_acquire) < threads) {
+            std::this_thread::yield ();
+        }
+        auto const start = std::chrono::steady_clock::now ();
+        go.store (true, std::memory_order_release);
+        for (std::thread & t : workers) {
+            t.join ();
+        }
+        return std::chrono::steady_clock::now () - start;
+    }
+
+    event_counter::event_counter (kind const k) noexcept {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.size = sizeof (attr);
+        if (k == kind::cache_misses) {
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        } else {
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8U) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U);
+        }
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int> (::syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)k;
+#endif
+    }
+
+    event_counter::~event_counter () noexcept {
+#if defined(__linux__)
+        if (fd_ >= 0) {
+            ::close (fd_);
+        }
+#endif
+    }
+
+    void event_counter::start () noexcept {
+#if defined(__linux__)
+        if (fd_ >= 0) {
+            ::ioctl (fd_, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl (fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    std::optional<std::uint64_t> event_counter::stop () noexcept {
+#if defined(__linux__)
+        if (fd_ >= 0) {
+            ::ioctl (fd_, PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t count = 0;
+            if (::read (fd_, &count, sizeof (count)) == sizeof (count)) {
+                return count;
+            }
+        }
+#endif
+        return std::nullopt;
+    }
+
+    std::vector<std::uint32_t> make_keys (std::size_t const keys, double const skew,
+                                          std::uint64_t const seed) {
+        std::mt19937_64 rng{seed};
+        std::vector<std::uint32_t> permutation (keys);
+        std::iota (std::begin (permutation), std::end (permutation), std::uint32_t{0});
+        std::shuffle (std::begin (permutation), std::end (permutation), rng);
+        if (skew == 0.0) {
+            return permutation;
+        }
+
+        // The cumulative weight of ranks [0, n] is cdf[n]. The key of rank r is permutation[r].
+        std::vector<double> cdf (keys);
+        auto total = 0.0;
+        for (auto rank = std::size_t{0}; rank < keys; ++rank) {
+            total += 1.0 / std::pow (static_cast<double> (rank + 1U), skew);
+            cdf[rank] = total;
+        }
+        std::uniform_real_distribution<double> uniform{0.0, total};
+        std::vector<std::uint32_t> result (keys);
+        std::generate (std::begin (result), std::end (result), [&] {
+            auto const rank = std::lower_bound (std::begin (cdf), std::end (cdf), uniform (rng)) -
+                              std::begin (cdf);
+            return permutation[std::min (static_cast<std::size_t> (rank), keys - 1U)];
+        });
+        return result;
+    }
+
+} // end namespace bench
@@ -0,0 +1,85 @@
+#ifndef BENCH_HARNESS_HPP
+#define BENCH_HARNESS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+    /// The settings shared by every benchmark.
+    struct config {
+        /// The largest number of threads to use. Each benchmark runs with 1, 2, 4, ... threads up
+        /// to this number.
+        unsigned max_threads = 1U;
+        /// The number of operations performed by each trial (divided among its threads).
+        std::size_t operations = std::size_t{1} << 20U;
+        /// Only benchmarks whose names contain this string are run.
+        std::string filter;
+
+        /// The thread counts to use: powers of two up to max_threads, and max_threads itself.
+        std::vector<unsigned> thread_counts () const;
+        bool selected (std::string const & name) const {
+            return name.find (filter) != std::string::npos;
+        }
+    };
+
+    /// The result of a single trial.
+    struct measurement {
+        std::string name;
+        unsigned threads = 1U;
+        /// Additional numeric parameters of the trial (for example, the key skew).
+        std::vector<std::pair<std::string, double>> params;
+        std::uint64_t operations = 0U;
+        std::chrono::duration<double> elapsed{0};
+    };
+
+    /// Accumulates measurements and writes them as a JSON document.
+    class report {
+    public:
+        void add (measurement m);
+        void write (std::ostream & os) const;
+
+    private:
+        std::vector<measurement> results_;
+    };
+
+    /// Runs \p fn (index) on \p threads threads at once, where index is in [0, threads).
+    /// \returns The time from the start of the first thread to the end of the last.
+    std::chrono::duration<double> run_parallel (unsigned threads,
+                                                std::function<void (unsigned)> const & fn);
+
+    /// A hardware event counter for the calling thread. On hosts without perf_event_open(), or
+    /// where the kernel refuses access, the counter is unavailable and stop() has no value.
+    class event_counter {
+    public:
+        enum class kind { cache_misses, dtlb_load_misses };
+
+        explicit event_counter (kind k) noexcept;
+        event_counter (event_counter const &) = delete;
+        event_counter & operator= (event_counter const &) = delete;
+        ~event_counter () noexcept;
+
+        void start () noexcept;
+        std::optional<std::uint64_t> stop () noexcept;
+
+    private:
+        int fd_ = -1;
+    };
+
+    /// Returns the keys to be used by the operations of a trial. Each key is in [0, keys).
+    ///
+    /// \param skew  The exponent of a Zipf distribution from which the keys are drawn. The hot
+    ///   keys are scattered across the key space. If zero, the result is a permutation of every
+    ///   key so that no two operations share a key.
+    std::vector<std::uint32_t> make_keys (std::size_t keys, double skew, std::uint64_t seed);
+
+} // end namespace bench
+
+#endif // BENCH_HARNESS_HPP
@@ -0,0 +1,79 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "benchmarks.hpp"
+
+namespace {
+
+    bool starts_with (std::string const & s, std::string const & prefix) {
+        return s.compare (0, prefix.length (), prefix) == 0;
+    }
+
+    struct options {
+        bench::config cfg;
+        /// The file to which the JSON report is written. If empty, it is written to stdout.
+        std::string output;
+    };
+
+    std::optional<options> parse_options (int const argc, char const * const * const argv) {
+        options opts;
+        opts.cfg.max_threads = std::max (std::thread::hardware_concurrency (), 1U);
+        for (auto arg = 1; arg < argc; ++arg) {
+            std::string const a = argv[arg];
+            if (starts_with (a, "--threads=")) {
+                opts.cfg.max_threads = static_cast<unsigned> (std::stoul (a.substr (10)));
+            } else if (starts_with (a, "--ops=")) {
+                opts.cfg.operations = std::stoull (a.substr (6));
+            } else if (starts_with (a, "--filter=")) {
+                opts.cfg.filter = a.substr (9);
+            } else if (starts_with (a, "--output=")) {
+                opts.output = a.substr (9);
+            } else {
+                return std::nullopt;
+            }
+        }
+        if (opts.cfg.max_threads == 0U || opts.cfg.operations == 0U) {
+            return std::nullopt;
+        }
+        return opts;
+    }
+
+    void usage (char const * const argv0) {
+        std::cerr << "Usage: " << argv0 << " [options]\n"
+                  << "  --threads=<n>   The largest number of threads (default: all cores)\n"
+                  << "  --ops=<n>       The number of operations in each trial\n"
+                  << "  --filter=<s>    Run only the benchmarks whose names contain s\n"
+                  << "  --output=<file> Write the JSON report to a file rather than stdout\n";
+    }
+
+} // end anonymous namespace
+
+// Runs the microbenchmarks and writes the results as JSON.
+int main (int argc, char ** argv) {
+    std::optional<options> const opts = parse_options (argc, argv);
+    if (!opts) {
+        usage (argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bench::report report;
+    bench::shadow_benchmarks (opts->cfg, report);
+    bench::visited_benchmarks (opts->cfg, report);
+    bench::symbol_benchmarks (opts->cfg, report);
+
+    if (opts->output.empty ()) {
+        report.write (std::cout);
+    } else {
+        std::ofstream os{opts->output};
+        report.write (os);
+        if (!os) {
+            std::cerr << "Error: could not write " << opts->output << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,313 @@
+#include "benchmarks.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "compilationref.hpp"
+#include "context.hpp"
+#include "shadow.hpp"
+#include "shadow_batch.hpp"
+
+namespace {
+
+    /// The key skews used for every transition. 0 gives each operation its own key.
+    constexpr double skews[] = {0.0, 0.5, 0.99, 1.2};
+
+    /// A context whose shadow memory holds one pointer for each key.
+    std::unique_ptr<context> make_context (std::size_t const keys) {
+        return std::make_unique<context> ([keys] {
+            auto repo = std::make_unique<repository> ();
+            repo->size = keys * sizeof (address);
+            return std::unique_ptr<repository_view const>{std::move (repo)};
+        });
+    }
+
+    address key_address (std::uint32_t const key) noexcept {
+        return address{std::uintptr_t{key} * sizeof (address)};
+    }
+
+    // The operations of each trial are divided evenly among its threads.
+    template <typename Function>
+    void for_each_key (std::vector<std::uint32_t> const & keys, unsigned const index,
+                       unsigned const threads, Function function) {
+        auto const first = keys.size () * index / threads;
+        auto const last = keys.size () * (index + 1U) / threads;
+        for (auto k = first; k < last; ++k) {
+            function (keys[k]);
+        }
+    }
+
+    /// The state of the shadow memory before a trial and the callbacks passed to shadow::set().
+    /// Each counts the operations that performed the transition being measured.
+    enum class transition { null_to_symbol, compilationref_to_compilationref, undef_to_def };
+
+    char const * name (transition const t) {
+        switch (t) {
+        case transition::null_to_symbol: return "shadow_set/null_to_symbol";
+        case transition::compilationref_to_compilationref:
+            return "shadow_set/compilationref_to_compilationref";
+        case transition::undef_to_def: return "shadow_set/undef_to_def";
+        }
+        return "";
+    }
+
+    bench::measurement trial (transition const t, unsigned const threads, double const skew,
+                              std::vector<std::uint32_t> const & keys) {
+        std::unique_ptr<context> ctx = make_context (keys.size ());
+
+        // Every thread has a compilationref with a different archive position. The one with the
+        // lowest position is kept, as archive discovery would.
+        std::vector<std::unique_ptr<compilationref>> refs;
+        for (auto index = 0U; index <= threads; ++index) {
+            refs.push_back (std::make_unique<compilationref> (digest{index}, "bench.a(bench.o)",
+                                                              arch_position{index + 1U, 0U}));
+        }
+        if (t != transition::null_to_symbol) {
+            for (auto key = std::uint32_t{0}; key < keys.size (); ++key) {
+                auto const a = key_address (key);
+                auto p = t == transition::undef_to_def
+                             ? shadow::tagged_pointer{new_symbol (*ctx, a)}
+                             : shadow::tagged_pointer{refs.back ().get ()};
+                ctx->shadow_pointer (a)->store (p.as_void_pointer (), std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic<std::uint64_t> transitions{0U};
+        auto const elapsed = bench::run_parallel (threads, [&] (unsigned const index) {
+            auto count = std::uint64_t{0};
+            compilationref * const mine = refs[index].get ();
+            for_each_key (keys, index, threads, [&] (std::uint32_t const key) {
+                auto const a = key_address (key);
+                auto const create = [&] {
+                    ++count;
+                    return shadow::tagged_pointer{new_symbol (*ctx, a, index)};
+                };
+                auto const create_from_compilationref = [&] (std::atomic<void *> *,
+                                                             compilationref * const cr) {
+                    if (mine->position < cr->position) {
+                        ++count;
+                        return shadow::tagged_pointer{mine};
+                    }
+                    return shadow::tagged_pointer{cr};
+                };
+                auto const update = [&] (std::atomic<void *> *, symbol_handle const sym) {
+                    if (t == transition::undef_to_def && !ctx->symbols.is_def (sym)) {
+                        ++count;
+                        ctx->undefs.erase (a);
+                        ctx->symbols.set_ordinal (sym, index);
+                    }
+                    return shadow::tagged_pointer{sym};
+                };
+                shadow::set (ctx->shadow_pointer (a), create, create_from_compilationref, update);
+            });
+            transitions.fetch_add (count, std::memory_order_relaxed);
+        });
+
+        bench::measurement m;
+        m.name = name (t);
+        m.threads = threads;
+        m.params = {{"skew", skew},
+                    {"keys", static_cast<double> (keys.size ())},
+                    {"transitions", static_cast<double> (transitions.load ())}};
+        m.operations = keys.size ();
+        m.elapsed = elapsed;
+        return m;
+    }
+
+    /// The order in which the shadow memory updates of each compilation are applied.
+    enum class order { repository, repository_prefetch, address, address_prefetch };
+
+    char const * name (order const o) {
+        switch (o) {
+        case order::repository: return "shadow_order/repository";
+        case order::repository_prefetch: return "shadow_order/repository_prefetch";
+        case order::address: return "shadow_order/address";
+        case order::address_prefetch: return "shadow_order/address_prefetch";
+        }
+        return "";
+    }
+
+    /// The number of names updated by each compilation.
+    constexpr auto names_per_compilation = std::size_t{1} << 16U;
+    /// The names are drawn at random from this many times as many shadow pointers as there are
+    /// updates.
+    constexpr auto pointers_per_update = std::size_t{4};
+
+    /// Returns the names updated by each of a number of large compilations. There are \p updates
+    /// names in total scattered over a shadow memory region of updates * pointers_per_update
+    /// pointers.
+    std::vector<std::vector<address>> make_compilations (std::size_t const updates) {
+        std::mt19937_64 rng{updates};
+        std::uniform_int_distribution<std::uintptr_t> pick{
+            0U, updates * pointers_per_update - 1U};
+        auto const size = std::min (updates, names_per_compilation);
+        std::vector<std::vector<address>> compilations (updates / size);
+        for (std::vector<address> & compilation : compilations) {
+            compilation.reserve (size);
+            for (auto ctr = std::size_t{0}; ctr < size; ++ctr) {
+                compilation.push_back (address{pick (rng) * sizeof (address)});
+            }
+        }
+        return compilations;
+    }
+
+    /// Makes the shadow pointer for \p a record a symbol or, if it already does, leaves it
+    /// unchanged: the same transitions as symbol resolution without the symbol table.
+    void set_symbol (context & ctx, address const a, std::uint32_t const handle) {
+        shadow::set (
+            ctx.shadow_pointer (a),
+            [handle] { return shadow::tagged_pointer{symbol_handle{handle}}; },
+            [] (std::atomic<void *> *, compilationref * const cr) {
+                return shadow::tagged_pointer{cr};
+            },
+            [] (std::atomic<void *> *, symbol_handle const sym) {
+                return shadow::tagged_pointer{sym};
+            });
+    }
+
+    /// Applies the updates of \p compilation in the order \p o.
+    void apply (order const o, context & ctx, shadow::batch & batch,
+                std::vector<address> const & compilation) {
+        if (o == order::address || o == order::address_prefetch) {
+            batch.clear ();
+            for (address const a : compilation) {
+                batch.add (a, false);
+            }
+            auto handle = std::uint32_t{0};
+            batch.apply ([&ctx] (address const a) { return ctx.shadow_pointer (a); },
+                         [&] (address const a, bool) { set_symbol (ctx, a, handle++); });
+            return;
+        }
+        constexpr auto distance = shadow::batch::default_prefetch_distance;
+        auto const size = compilation.size ();
+        for (auto ctr = std::size_t{0}; ctr < size; ++ctr) {
+            if (o == order::repository_prefetch && ctr + distance < size) {
+                shadow::prefetch (ctx.shadow_pointer (compilation[ctr + distance]));
+            }
+            set_symbol (ctx, compilation[ctr], static_cast<std::uint32_t> (ctr));
+        }
+    }
+
+    /// The sum of an event count over the threads of a trial. It has no value if the counter was
+    /// unavailable to any of them.
+    class event_total {
+    public:
+        void add (std::optional<std::uint64_t> const & count) noexcept {
+            if (count) {
+                total_.fetch_add (*count, std::memory_order_relaxed);
+            } else {
+                available_.store (false, std::memory_order_relaxed);
+            }
+        }
+        std::optional<std::uint64_t> get () const noexcept {
+            if (!available_.load (std::memory_order_relaxed)) {
+                return std::nullopt;
+            }
+            return total_.load (std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::uint64_t> total_{0U};
+        std::atomic<bool> available_{true};
+    };
+
+    bench::measurement trial (order const o, unsigned const threads,
+                              std::vector<std::vector<address>> const & compilations,
+                              std::size_t const updates) {
+        std::unique_ptr<context> ctx = make_context (updates * pointers_per_update);
+        // Fault in the shadow memory so that the trial measures cache and TLB misses rather than
+        // page faults.
+        std::memset (ctx->shadow.data (), 0, ctx->shadow.size ());
+
+        event_total cache_misses;
+        event_total dtlb_misses;
+        auto const elapsed = bench::run_parallel (threads, [&] (unsigned const index) {
+            auto const prefetch_distance =
+                o == order::address_prefetch ? shadow::batch::default_prefetch_distance : 0U;
+            shadow::batch batch{prefetch_distance};
+            bench::event_counter cache{bench::event_counter::kind::cache_misses};
+            bench::event_counter dtlb{bench::event_counter::kind::dtlb_load_misses};
+            cache.start ();
+            dtlb.start ();
+            auto const last = compilations.size () * (index + 1U) / threads;
+            for (auto c = compilations.size () * index / threads; c < last; ++c) {
+                apply (o, *ctx, batch, compilations[c]);
+            }
+            dtlb_misses.add (dtlb.stop ());
+            cache_misses.add (cache.stop ());
+        });
+
+        // The number of shadow pointers which were set lets the orders be compared.
+        auto set = std::uint64_t{0};
+        auto const * const words = reinterpret_cast<std::uintptr_t const *> (ctx->shadow.data ());
+        for (auto ctr = std::size_t{0}; ctr < ctx->shadow.size () / sizeof (std::uintptr_t);
+             ++ctr) {
+            set += words[ctr] != 0U;
+        }
+
+        auto operations = std::size_t{0};
+        for (std::vector<address> const & compilation : compilations) {
+            operations += compilation.size ();
+        }
+        bench::measurement m;
+        m.name = name (o);
+        m.threads = threads;
+        m.params = {{"names_per_compilation", static_cast<double> (compilations.front ().size ())},
+                    {"shadow_bytes", static_cast<double> (ctx->shadow.size ())},
+                    {"pointers_set", static_cast<double> (set)}};
+        auto const per_operation = [operations] (char const * const key,
+                                                 std::optional<std::uint64_t> const & count) {
+            return std::make_pair (std::string{key}, static_cast<double> (*count) /
+                                                         static_cast<double> (operations));
+        };
+        if (auto const count = cache_misses.get ()) {
+            m.params.push_back (per_operation ("cache_misses_per_op", count));
+        }
+        if (auto const count = dtlb_misses.get ()) {
+            m.params.push_back (per_operation ("dtlb_misses_per_op", count));
+        }
+        m.operations = operations;
+        m.elapsed = elapsed;
+        return m;
+    }
+
+} // end anonymous namespace
+
+namespace bench {
+
+    void shadow_benchmarks (config const & cfg, report & r) {
+        for (transition const t : {transition::null_to_symbol,
+                                   transition::compilationref_to_compilationref,
+                                   transition::undef_to_def}) {
+            if (!cfg.selected (name (t))) {
+                continue;
+            }
+            for (double const skew : skews) {
+                auto const keys = make_keys (cfg.operations, skew, cfg.operations);
+                for (unsigned const threads : cfg.thread_counts ()) {
+                    r.add (trial (t, threads, skew, keys));
+                }
+            }
+        }
+
+        std::vector<std::vector<address>> compilations;
+        for (order const o :
+             {order::repository, order::repository_prefetch, order::address,
+              order::address_prefetch}) {
+            if (!cfg.selected (name (o))) {
+                continue;
+            }
+            if (compilations.empty ()) {
+                compilations = make_compilations (cfg.operations);
+            }
+            for (unsigned const threads : cfg.thread_counts ()) {
+                r.add (trial (o, threads, compilations, cfg.operations));
+            }
+        }
+    }
+
+} // end namespace bench
@@ -0,0 +1,52 @@
+#include "benchmarks.hpp"
+
+#include <memory>
+
+#include "context.hpp"
+#include "symbol.hpp"
+
+namespace {
+
+    bench::measurement trial (char const * const name, bool const defined,
+                              std::size_t const symbols, unsigned const threads) {
+        context ctx{[symbols] {
+            auto repo = std::make_unique<repository> ();
+            repo->size = symbols * sizeof (address);
+            return std::unique_ptr<repository_view const>{std::move (repo)};
+        }};
+        auto const elapsed = bench::run_parallel (threads, [&] (unsigned const index) {
+            auto const last = symbols * (index + 1U) / threads;
+            for (auto s = symbols * index / threads; s < last; ++s) {
+                address const a{s * sizeof (address)};
+                if (defined) {
+                    new_symbol (ctx, a, index);
+                } else {
+                    new_symbol (ctx, a);
+                }
+            }
+        });
+
+        bench::measurement m;
+        m.name = name;
+        m.threads = threads;
+        m.operations = symbols;
+        m.elapsed = elapsed;
+        return m;
+    }
+
+} // end anonymous namespace
+
+namespace bench {
+
+    void symbol_benchmarks (config const & cfg, report & r) {
+        for (unsigned const threads : cfg.thread_counts ()) {
+            if (cfg.selected ("new_symbol/def")) {
+                r.add (trial ("new_symbol/def", true, cfg.operations, threads));
+            }
+            if (cfg.selected ("new_symbol/undef")) {
+                r.add (trial ("new_symbol/undef", false, cfg.operations, threads));
+            }
+        }
+    }
+
+} // end namespace bench
@@ -0,0 +1,79 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+
+#include "CompletionOrder.h"
+#include "Visited.h"
+
+namespace {
+
+    /// Runs one trial with the given number of producer threads and a single consumer. Each
+    /// producer completes 'batch' consecutive files at a time; the consumer takes up to
+    /// 'consumer_batch' files at a time.
+    bench::measurement trial (char const * const name, unsigned files, unsigned const producers,
+                              unsigned const batch, unsigned const consumer_batch) {
+        files -= files % batch;
+        auto const order = completionOrder (files / batch);
+        Visited visited;
+        std::atomic<std::size_t> next_block{0U};
+        std::atomic<unsigned> running{producers};
+
+        // Thread 0 is the consumer; the rest are producers.
+        auto const elapsed = bench::run_parallel (producers + 1U, [&] (unsigned const index) {
+            if (index == 0U) {
+                auto expected = 0U;
+                while (std::optional<Visited::Range> const r = visited.nextRange (consumer_batch)) {
+                    if (r->First != expected) {
+                        std::cerr << "Out of sequence ordinal " << r->First << '\n';
+                        std::exit (EXIT_FAILURE);
+                    }
+                    expected = r->Last;
+                }
+                return;
+            }
+            for (;;) {
+                auto const i = next_block.fetch_add (1U, std::memory_order_relaxed);
+                if (i >= order.size ()) {
+                    break;
+                }
+                auto const first = order[i] * batch;
+                if (batch == 1U) {
+                    visited.fileCompleted (first);
+                } else {
+                    visited.fileCompletedRange (first, first + batch);
+                }
+            }
+            if (running.fetch_sub (1U, std::memory_order_acq_rel) == 1U) {
+                visited.done ();
+            }
+        });
+
+        bench::measurement m;
+        m.name = name;
+        m.threads = producers;
+        m.params = {{"producer_batch", batch}, {"consumer_batch", consumer_batch}};
+        m.operations = files;
+        m.elapsed = elapsed;
+        return m;
+    }
+
+} // end anonymous namespace
+
+namespace bench {
+
+    void visited_benchmarks (config const & cfg, report & r) {
+        auto const files = static_cast<unsigned> (cfg.operations);
+        for (unsigned const producers : cfg.thread_counts ()) {
+            if (cfg.selected ("visited/single")) {
+                r.add (trial ("visited/single", files, producers, 1U, 1U));
+            }
+            if (cfg.selected ("visited/range")) {
+                r.add (trial ("visited/range", files, producers, 16U, 512U));
+            }
+        }
+    }
+
+} // end namespace bench
@@ -0,0 +1,64 @@
+#include "allocation_count.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    // The count is split between a number of cache lines so that threads rarely contend. Each
+    // thread always increments the same line, chosen by the address of a thread-local variable.
+    struct alignas (64) stripe {
+        std::atomic<std::uint64_t> count{0};
+    };
+    std::array<stripe, 64> stripes;
+    thread_local std::uint64_t thread_count = 0;
+
+    void count_allocation () noexcept {
+        auto const index =
+            (reinterpret_cast<std::uintptr_t> (&thread_count) >> 6U) % stripes.size ();
+        stripes[index].count.fetch_add (1U, std::memory_order_relaxed);
+        ++thread_count;
+    }
+
+    void * allocate (std::size_t const size) {
+        count_allocation ();
+        if (void * const p = std::malloc (size != 0U ? size : 1U)) {
+            return p;
+        }
+        throw std::bad_alloc{};
+    }
+
+} // end anonymous namespace
+
+std::uint64_t allocation_count () noexcept {
+    auto result = std::uint64_t{0};
+    for (stripe const & s : stripes) {
+        result += s.count.load (std::memory_order_relaxed);
+    }
+    return result;
+}
+
+std::uint64_t thread_allocation_count () noexcept {
+    return thread_count;
+}
+
+void * operator new (std::size_t const size) {
+    return allocate (size);
+}
+void * operator new[] (std::size_t const size) {
+    return allocate (size);
+}
+void operator delete (void * const p) noexcept {
+    std::free (p);
+}
+void operator delete[] (void * const p) noexcept {
+    std::free (p);
+}
+void operator delete (void * const p, std::size_t) noexcept {
+    std::free (p);
+}
+void operator delete[] (void * const p, std::size_t) noexcept {
+    std::free (p);
+}
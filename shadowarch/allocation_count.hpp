@@ -0,0 +1,13 @@
+#ifndef ALLOCATION_COUNT_HPP
+#define ALLOCATION_COUNT_HPP
+
+#include <cstdint>
+
+/// Returns the number of calls made by the process to the global operator new. A program which
+/// calls this function links allocation_count.cpp, which replaces the global operator new and
+/// delete with versions that count allocations.
+std::uint64_t allocation_count () noexcept;
+/// Returns the number of calls to the global operator new made by the calling thread.
+std::uint64_t thread_allocation_count () noexcept;
+
+#endif // ALLOCATION_COUNT_HPP
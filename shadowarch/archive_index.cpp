@@ -0,0 +1,126 @@
+#include "archive_index.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#include "digest.hpp"
+
+namespace {
+
+    static_assert (sizeof (archive_index::entry) == 16U &&
+                   std::is_trivially_copyable_v<archive_index::entry>);
+    static_assert (sizeof (archive_index::header) == 32U);
+
+    std::string index_path (std::string const & directory, digest const archive) {
+        std::ostringstream os;
+        os << directory << '/' << std::hex << std::setw (16) << std::setfill ('0') << archive.v
+           << ".rldindex";
+        return os.str ();
+    }
+
+} // end anonymous namespace
+
+archive_index::archive_index (std::string const & directory, repository_view const & repo,
+                              std::vector<compilationref *> const & members) {
+    digest const archive = content_digest (members);
+    std::string const path = index_path (directory, archive);
+    if (!this->read (path, archive, members.size ())) {
+        this->build (repo, members);
+        this->write (path, archive);
+    }
+}
+
+digest archive_index::content_digest (std::vector<compilationref *> const & members) {
+    auto h = fnv1a_basis;
+    for (compilationref const * const cr : members) {
+        h = fnv1a (h, &cr->compilation, sizeof (cr->compilation));
+        h = fnv1a (h, cr->origin ().data (), cr->origin ().size () + 1U);
+    }
+    return digest{h};
+}
+
+bool archive_index::read (std::string const & path, digest const archive,
+                          std::size_t const members) {
+    std::unique_ptr<mapped_file> file;
+    try {
+        file = std::make_unique<mapped_file> (path);
+    } catch (std::runtime_error const &) {
+        return false;
+    }
+    header h{};
+    if (file->size () < sizeof (h)) {
+        return false;
+    }
+    std::memcpy (&h, file->data (), sizeof (h));
+    if (std::memcmp (h.magic, header::magic_value, sizeof (h.magic)) != 0 ||
+        h.version != header::current_version || h.archive != archive ||
+        h.count > (file->size () - sizeof (h)) / sizeof (entry) ||
+        file->size () != sizeof (h) + h.count * sizeof (entry)) {
+        return false;
+    }
+    span<entry const> const entries{reinterpret_cast<entry const *> (file->data () + sizeof (h)),
+                                    static_cast<std::size_t> (h.count)};
+    // The header cannot vouch for a stale or torn file: each entry must name one of the
+    // archive's members, and the entries must be sorted by name with no name repeated.
+    auto const * const first = entries.begin ();
+    for (auto const * e = first; e != entries.end (); ++e) {
+        if (e->member >= members || (e != first && !((e - 1)->name.v < e->name.v))) {
+            return false;
+        }
+    }
+    entries_ = entries;
+    file_ = std::move (file);
+    return true;
+}
+
+void archive_index::build (repository_view const & repo,
+                           std::vector<compilationref *> const & members) {
+    for (auto member = 0U; member < members.size (); ++member) {
+        for (auto const & definition : repo.definitions (members[member]->compilation)) {
+            built_.push_back (entry{definition.name, member, 0U});
+        }
+    }
+    std::sort (std::begin (built_), std::end (built_), [] (entry const & a, entry const & b) {
+        return a.name.v < b.name.v || (a.name == b.name && a.member < b.member);
+    });
+    // Keep the first member to define each name.
+    built_.erase (std::unique (std::begin (built_), std::end (built_),
+                               [] (entry const & a, entry const & b) { return a.name == b.name; }),
+                  std::end (built_));
+    entries_ = span<entry const>{built_.data (), built_.size ()};
+}
+
+void archive_index::write (std::string const & path, digest const archive) const {
+    header h{};
+    std::memcpy (h.magic, header::magic_value, sizeof (h.magic));
+    h.version = header::current_version;
+    h.archive = archive;
+    h.count = built_.size ();
+
+    // Another process may be writing the same index: the temporary file's name includes a
+    // random value as well as the thread ID.
+    std::ostringstream temp;
+    temp << path << '.' << std::this_thread::get_id () << '.' << std::hex
+         << std::random_device{}();
+    {
+        std::ofstream os{temp.str (), std::ios::binary | std::ios::trunc};
+        os.write (reinterpret_cast<char const *> (&h), sizeof (h));
+        os.write (reinterpret_cast<char const *> (built_.data ()),
+                  static_cast<std::streamsize> (built_.size () * sizeof (entry)));
+        if (!os) {
+            std::remove (temp.str ().c_str ());
+            return;
+        }
+    }
+    if (std::rename (temp.str ().c_str (), path.c_str ()) != 0) {
+        std::remove (temp.str ().c_str ());
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef ARCHIVE_INDEX_HPP
+#define ARCHIVE_INDEX_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "compilationref.hpp"
+#include "mapped_file.hpp"
+#include "repo.hpp"
+#include "span.hpp"
+
+/// A ranlib-style symbol index for one archive: the names defined by the archive's members,
+/// sorted by address. Where more than one member defines a name, only the first is recorded since
+/// a later member can never be chosen.
+///
+/// Indices are cached on disk, one file per archive, named for the digest of the archive's
+/// contents. An unchanged archive therefore reuses its index and archive discovery need not read
+/// the members' definitions from the repository.
+class archive_index {
+public:
+    // The index file. All integers are stored in host byte order.
+    //
+    // +-------------------+
+    // | header            |
+    // +-------------------+
+    // | entries           | entry[]: sorted by name
+    // +-------------------+
+
+    struct header {
+        static constexpr char magic_value[8] = {'R', 'L', 'D', 'I', 'N', 'D', 'E', 'X'};
+        static constexpr std::uint32_t current_version = 1U;
+
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t padding;
+        digest archive;
+        std::uint64_t count;
+    };
+
+    struct entry {
+        address name;
+        /// The index of the defining member in the archive's list of members.
+        std::uint32_t member;
+        std::uint32_t padding;
+    };
+
+    /// Loads the index of an archive from \p directory, building it from the repository (and
+    /// saving it) if it is not present. Failure to read or write the cached index is not an
+    /// error.
+    ///
+    /// \param directory  The directory holding the cached indices.
+    /// \param repo  The repository containing the archive members.
+    /// \param members  The archive's members in archive order.
+    archive_index (std::string const & directory, repository_view const & repo,
+                   std::vector<compilationref *> const & members);
+
+    /// Returns the digest of the contents of an archive with the given members.
+    static digest content_digest (std::vector<compilationref *> const & members);
+
+    span<entry const> entries () const noexcept { return entries_; }
+    /// True if the index was read from the cache rather than built.
+    bool warm () const noexcept { return file_ != nullptr; }
+
+private:
+    /// Maps the cached index at \p path if it is valid for the archive \p archive.
+    /// \param members  The number of members in the archive.
+    bool read (std::string const & path, digest archive, std::size_t members);
+    /// Builds the index from the repository.
+    void build (repository_view const & repo, std::vector<compilationref *> const & members);
+    /// Writes the index to \p path. Writes to a temporary file which is then renamed so that a
+    /// concurrent link never reads an incomplete index.
+    void write (std::string const & path, digest archive) const;
+
+    std::unique_ptr<mapped_file> file_;
+    std::vector<entry> built_;
+    span<entry const> entries_;
+};
+
+#endif // ARCHIVE_INDEX_HPP
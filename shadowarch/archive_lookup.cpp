@@ -0,0 +1,33 @@
+#include "archive_lookup.hpp"
+
+#include "digest_index.hpp"
+
+archive_lookup::archive_lookup (std::size_t const max_names)
+        : mask_{digest_index::capacity_for (max_names) - 1U}
+        , slots_{std::make_unique<slot[]> (mask_ + 1U)} {}
+
+std::size_t archive_lookup::first_slot (address const name) const noexcept {
+    return static_cast<std::size_t> (digest_index::mix (digest{name.v})) & mask_;
+}
+
+void archive_lookup::add (address const name, std::uint32_t const member) noexcept {
+    for (auto index = first_slot (name);; index = (index + 1U) & mask_) {
+        slot & s = slots_[index];
+        auto key = s.key.load (std::memory_order_relaxed);
+        if (key == empty) {
+            if (s.key.compare_exchange_strong (key, name.v, std::memory_order_relaxed)) {
+                size_.fetch_add (1U, std::memory_order_relaxed);
+                key = name.v;
+            }
+            // Otherwise another thread claimed the slot and 'key' now holds its name.
+        }
+        if (key == name.v) {
+            // Keep the lowest member index.
+            auto current = s.member.load (std::memory_order_relaxed);
+            while (member < current &&
+                   !s.member.compare_exchange_weak (current, member, std::memory_order_relaxed)) {
+            }
+            return;
+        }
+    }
+}
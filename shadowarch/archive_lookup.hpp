@@ -0,0 +1,66 @@
+#ifndef ARCHIVE_LOOKUP_HPP
+#define ARCHIVE_LOOKUP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "repo.hpp"
+
+/// Maps each name defined by an archive member to the first member (the one with the lowest
+/// archive position) which defines it. Lazy archive discovery records the archives' definitions
+/// here rather than in shadow memory: only the names which are referenced while undefined are
+/// ever given a shadow memory compilationref.
+///
+/// The table is a fixed-size, open-addressing hash table. Any number of threads may add to it
+/// concurrently without locks; lookups may start once every addition has completed.
+class archive_lookup {
+public:
+    /// The value returned by find() for a name which is not defined by any member.
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max ();
+
+    /// \param max_names  An upper bound on the number of names which will be added.
+    explicit archive_lookup (std::size_t max_names);
+
+    /// Records that the member with index \p member defines \p name. If more than one member
+    /// defines the name, the lowest index is kept, so members must be indexed in archive order.
+    void add (address name, std::uint32_t member) noexcept;
+
+    /// Returns the index of the first member which defines \p name or npos.
+    std::uint32_t find (address const name) const noexcept {
+        for (auto index = first_slot (name);; index = (index + 1U) & mask_) {
+            slot const & s = slots_[index];
+            auto const key = s.key.load (std::memory_order_relaxed);
+            if (key == name.v) {
+                return s.member.load (std::memory_order_relaxed);
+            }
+            if (key == empty) {
+                return npos;
+            }
+        }
+    }
+
+    /// The number of distinct names in the table.
+    std::size_t size () const noexcept { return size_.load (std::memory_order_relaxed); }
+    /// The number of bytes allocated for the table.
+    std::size_t bytes_allocated () const noexcept { return (mask_ + 1U) * sizeof (slot); }
+
+private:
+    /// The key of an empty slot. No name has this address.
+    static constexpr auto empty = std::numeric_limits<std::uint64_t>::max ();
+
+    struct slot {
+        std::atomic<std::uint64_t> key{empty};
+        std::atomic<std::uint32_t> member{npos};
+    };
+
+    std::size_t first_slot (address const name) const noexcept;
+
+    std::size_t const mask_;
+    std::unique_ptr<slot[]> const slots_;
+    std::atomic<std::size_t> size_{0U};
+};
+
+#endif // ARCHIVE_LOOKUP_HPP
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "digest_index.hpp"
+
+namespace {
+
+    // Generates a set of distinct digests with the given seed.
+    std::vector<digest> make_digests (std::size_t const count, std::uint64_t const seed) {
+        std::mt19937_64 rng{seed};
+        std::vector<digest> digests;
+        digests.reserve (count);
+        for (auto ctr = std::size_t{0}; ctr < count; ++ctr) {
+            digests.push_back (digest{rng ()});
+        }
+        std::sort (std::begin (digests), std::end (digests),
+                   [] (digest const a, digest const b) { return a.v < b.v; });
+        digests.erase (std::unique (std::begin (digests), std::end (digests)), std::end (digests));
+        return digests;
+    }
+
+    struct result {
+        std::chrono::duration<double> build;
+        std::chrono::duration<double> lookup;
+        std::uint64_t checksum;
+    };
+
+    // Times building an index over 'keys' and then looking up each of 'probes'. The checksum
+    // prevents the lookups from being optimized away and lets the rows be compared.
+    template <typename Build, typename Find>
+    result trial (std::vector<digest> const & keys, std::vector<digest> const & probes,
+                  Build build, Find find) {
+        auto const start = std::chrono::steady_clock::now ();
+        auto const index = build (keys);
+        auto const built = std::chrono::steady_clock::now ();
+        auto checksum = std::uint64_t{0};
+        for (digest const d : probes) {
+            checksum += find (index, d);
+        }
+        return {built - start, std::chrono::steady_clock::now () - built, checksum};
+    }
+
+    void show (char const * const name, std::size_t const entries, std::size_t const lookups,
+               result const & r) {
+        std::cout << std::left << std::setw (16) << name << std::right << std::setw (12) << entries
+                  << std::setw (12) << std::fixed << std::setprecision (3) << r.build.count ()
+                  << std::setw (14) << std::setprecision (2)
+                  << r.lookup.count () * 1e9 / static_cast<double> (lookups) << std::setw (22)
+                  << r.checksum << '\n';
+    }
+
+    void run (std::size_t const entries) {
+        // The keys are inserted in an arbitrary (random) order, the same order in which a
+        // repository would add them.
+        std::vector<digest> keys = make_digests (entries, entries);
+        std::mt19937_64 rng{entries + 1U};
+        std::shuffle (std::begin (keys), std::end (keys), rng);
+
+        // Each key is looked up a few times, in random order, as a link would.
+        std::vector<digest> probes;
+        probes.reserve (keys.size () * 4U);
+        for (auto ctr = 0; ctr < 4; ++ctr) {
+            probes.insert (std::end (probes), std::begin (keys), std::end (keys));
+        }
+        std::shuffle (std::begin (probes), std::end (probes), rng);
+
+        show ("unordered_map", keys.size (), probes.size (),
+              trial (
+                  keys, probes,
+                  [] (std::vector<digest> const & ks) {
+                      std::unordered_map<digest, std::uint32_t> map;
+                      map.reserve (ks.size ());
+                      for (auto ctr = std::size_t{0}; ctr < ks.size (); ++ctr) {
+                          map.emplace (ks[ctr], static_cast<std::uint32_t> (ctr));
+                      }
+                      return map;
+                  },
+                  [] (std::unordered_map<digest, std::uint32_t> const & map, digest const d) {
+                      return map.find (d)->second;
+                  }));
+
+        show ("sorted vector", keys.size (), probes.size (),
+              trial (
+                  keys, probes,
+                  [] (std::vector<digest> const & ks) {
+                      std::vector<std::pair<digest, std::uint32_t>> v;
+                      v.reserve (ks.size ());
+                      for (auto ctr = std::size_t{0}; ctr < ks.size (); ++ctr) {
+                          v.emplace_back (ks[ctr], static_cast<std::uint32_t> (ctr));
+                      }
+                      std::sort (std::begin (v), std::end (v), [] (auto const & a, auto const & b) {
+                          return a.first.v < b.first.v;
+                      });
+                      return v;
+                  },
+                  [] (std::vector<std::pair<digest, std::uint32_t>> const & v, digest const d) {
+                      return std::lower_bound (std::begin (v), std::end (v), d,
+                                               [] (auto const & a, digest const k) {
+                                                   return a.first.v < k.v;
+                                               })
+                          ->second;
+                  }));
+
+        show ("digest_index", keys.size (), probes.size (),
+              trial (
+                  keys, probes,
+                  [] (std::vector<digest> const & ks) {
+                      digest_index index{ks.size ()};
+                      for (auto ctr = std::size_t{0}; ctr < ks.size (); ++ctr) {
+                          index.insert (ks[ctr], static_cast<std::uint32_t> (ctr));
+                      }
+                      return index;
+                  },
+                  [] (digest_index const & index, digest const d) { return index.find (d); }));
+    }
+
+} // end anonymous namespace
+
+// Compares the cost of building and querying the digest indexes used by the repository:
+// std::unordered_map (the original in-memory representation), a sorted vector searched with
+// std::lower_bound (the original on-disk representation) and digest_index.
+//
+// Usage: rld-shadowarch-bench [max-entries]
+int main (int argc, char ** argv) {
+    auto const max_entries = argc > 1 ? std::stoull (argv[1]) : std::size_t{1} << 22U;
+
+    std::cout << std::left << std::setw (16) << "index" << std::right << std::setw (12)
+              << "entries" << std::setw (12) << "build (s)" << std::setw (14) << "ns/lookup"
+              << std::setw (22) << "checksum" << '\n';
+    for (auto entries = std::size_t{1} << 16U; entries <= max_entries; entries *= 4U) {
+        run (entries);
+    }
+    return EXIT_SUCCESS;
+}
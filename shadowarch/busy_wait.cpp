@@ -0,0 +1,96 @@
+#include "busy_wait.hpp"
+
+#include "timeline.hpp"
+
+namespace shadow {
+
+    wait_policy & current_wait_policy () noexcept {
+        static wait_policy policy;
+        return policy;
+    }
+
+    contention_stats & contention_stats::get () noexcept {
+        static contention_stats stats;
+        return stats;
+    }
+
+    void contention_stats::record (atomic_void_ptr const * const p, std::uint64_t const spins,
+                                   std::uint64_t const parks) {
+        shard & s = shards_[(reinterpret_cast<std::uintptr_t> (p) / sizeof (void *)) %
+                            shards_.size ()];
+        std::lock_guard<std::mutex> _{s.mutex};
+        counters & c = s.m[p];
+        ++c.busy_encounters;
+        c.spin_iterations += spins;
+        c.parks += parks;
+    }
+
+    auto contention_stats::snapshot () const
+        -> std::vector<std::pair<atomic_void_ptr const *, counters>> {
+        std::vector<std::pair<atomic_void_ptr const *, counters>> result;
+        for (shard const & s : shards_) {
+            std::lock_guard<std::mutex> _{s.mutex};
+            result.insert (std::end (result), std::begin (s.m), std::end (s.m));
+        }
+        return result;
+    }
+
+    namespace details {
+
+        parking_bucket & bucket_for (atomic_void_ptr const * const p) noexcept {
+            static std::array<parking_bucket, 256> buckets;
+            return buckets[(reinterpret_cast<std::uintptr_t> (p) / sizeof (void *)) %
+                           buckets.size ()];
+        }
+
+        void * park (atomic_void_ptr * const p) {
+            parking_bucket & bucket = bucket_for (p);
+            std::unique_lock<std::mutex> lock{bucket.mutex};
+            bucket.waiters.fetch_add (1U, std::memory_order_seq_cst);
+            void * value = nullptr;
+            bucket.cv.wait (lock, [p, &value] {
+                value = p->load (std::memory_order_seq_cst);
+                return value != busy;
+            });
+            bucket.waiters.fetch_sub (1U, std::memory_order_relaxed);
+            return value;
+        }
+
+        void * wait_while_busy (atomic_void_ptr * const p) {
+            timeline::scope const _{"busy wait"};
+            wait_policy const & policy = current_wait_policy ();
+            auto spins = std::uint64_t{0};
+            auto parks = std::uint64_t{0};
+            void * value = p->load (std::memory_order_acquire);
+
+            // Phase 1: spin with a pause between each check.
+            for (auto n = 0U; value == busy && n < policy.spins; ++n) {
+                cpu_relax ();
+                ++spins;
+                value = p->load (std::memory_order_acquire);
+            }
+            // Phase 2: exponential backoff.
+            for (auto round = 0U; value == busy && round < policy.backoff_rounds; ++round) {
+                auto const pauses = std::uint64_t{1} << round;
+                for (auto n = std::uint64_t{0}; n < pauses; ++n) {
+                    cpu_relax ();
+                }
+                spins += pauses;
+                value = p->load (std::memory_order_acquire);
+            }
+            // Phase 3: park until the owning thread releases the pointer.
+            if (value == busy) {
+                value = park (p);
+                ++parks;
+            }
+
+            contention_stats & stats = contention_stats::get ();
+            if (stats.enabled ()) {
+                stats.record (p, spins, parks);
+            }
+            return value;
+        }
+
+    } // end namespace details
+
+} // end namespace shadow
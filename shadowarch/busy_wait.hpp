@@ -0,0 +1,119 @@
+#ifndef BUSY_WAIT_HPP
+#define BUSY_WAIT_HPP
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+namespace shadow {
+
+    using void_ptr = void *;
+    using atomic_void_ptr = std::atomic<void *>;
+
+    auto * const busy = reinterpret_cast<void_ptr> (std::numeric_limits<uintptr_t>::max ());
+
+    /// Controls how a thread waits when it finds a shadow pointer in the busy state. The waiter
+    /// first spins executing a pause instruction, then backs off exponentially, and finally parks
+    /// until the thread which owns the pointer releases it.
+    struct wait_policy {
+        /// The number of times that the pointer is checked (with a pause between each) before
+        /// backing off.
+        unsigned spins = 64U;
+        /// The number of exponential backoff rounds before parking. Round n pauses 2^n times.
+        unsigned backoff_rounds = 8U;
+    };
+
+    /// The wait policy used by all threads. Must not be modified while a link is in progress.
+    wait_policy & current_wait_policy () noexcept;
+
+    /// Records how often threads had to wait for each shadow pointer so that contended symbols
+    /// can be identified. Recording is disabled by default.
+    class contention_stats {
+    public:
+        struct counters {
+            /// The number of times that a thread found the pointer busy.
+            std::uint64_t busy_encounters = 0U;
+            /// The total number of pause instructions executed while waiting.
+            std::uint64_t spin_iterations = 0U;
+            /// The number of times that a waiting thread was parked.
+            std::uint64_t parks = 0U;
+        };
+
+        static contention_stats & get () noexcept;
+
+        bool enabled () const noexcept { return enabled_.load (std::memory_order_relaxed); }
+        void enable (bool const e) noexcept { enabled_.store (e, std::memory_order_relaxed); }
+
+        void record (atomic_void_ptr const * p, std::uint64_t spins, std::uint64_t parks);
+
+        /// Returns the recorded counters for each pointer that was found busy.
+        std::vector<std::pair<atomic_void_ptr const *, counters>> snapshot () const;
+
+    private:
+        struct alignas (64) shard {
+            mutable std::mutex mutex;
+            std::unordered_map<atomic_void_ptr const *, counters> m;
+        };
+        std::atomic<bool> enabled_{false};
+        std::array<shard, 64> shards_;
+    };
+
+    namespace details {
+
+        /// Executes the host's spin-loop hint instruction.
+        inline void cpu_relax () noexcept {
+#if defined(__i386__) || defined(__x86_64__)
+            __builtin_ia32_pause ();
+#elif defined(__aarch64__) || defined(__arm__)
+            __asm__ __volatile__ ("yield");
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+            _mm_pause ();
+#elif defined(_MSC_VER) && (defined(_M_ARM) || defined(_M_ARM64))
+            __yield ();
+#endif
+        }
+
+        /// The parking lot is a fixed table of buckets. Threads waiting for a busy pointer block
+        /// on the condition variable of the bucket to which the pointer hashes.
+        struct alignas (64) parking_bucket {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::atomic<unsigned> waiters{0};
+        };
+        parking_bucket & bucket_for (atomic_void_ptr const * p) noexcept;
+
+        /// Blocks until the value of \p p is no longer busy.
+        /// \returns The value contained within the atomic.
+        void * park (atomic_void_ptr * p);
+
+        /// Stores \p value to a pointer that the caller had set to busy and wakes any threads
+        /// parked waiting for it.
+        inline void release (atomic_void_ptr * const p, void * const value) {
+            // A parking thread increments the waiter count before it checks the pointer for the
+            // last time. Either it sees our store or we see its count and wake it.
+            p->store (value, std::memory_order_seq_cst);
+            parking_bucket & bucket = bucket_for (p);
+            if (bucket.waiters.load (std::memory_order_seq_cst) > 0U) {
+                std::lock_guard<std::mutex> _{bucket.mutex};
+                bucket.cv.notify_all ();
+            }
+        }
+
+        /// Waits until the value of \p p is no longer busy according to current_wait_policy().
+        /// \returns The value contained within the atomic.
+        void * wait_while_busy (atomic_void_ptr * p);
+
+    } // end namespace details
+
+} // end namespace shadow
+
+#endif // BUSY_WAIT_HPP
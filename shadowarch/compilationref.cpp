@@ -1 +1,18 @@
 #include "compilationref.hpp"
+
+origin_table & origin_table::get () {
+    static origin_table table;
+    return table;
+}
+
+auto origin_table::intern (std::string const & origin) -> index {
+    std::lock_guard<std::mutex> _{mutex_};
+    auto const pos = indices_.find (origin);
+    if (pos != std::end (indices_)) {
+        return pos->second;
+    }
+    auto const result = static_cast<index> (strings_.size ());
+    strings_.push_back (origin);
+    indices_.emplace (strings_.back (), result);
+    return result;
+}
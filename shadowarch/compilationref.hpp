@@ -1,27 +1,78 @@
 #ifndef COMPILATIONREF_HPP
 #define COMPILATIONREF_HPP
 
-#include <string>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 
 #include "repo.hpp"
 
-using arch_position = std::pair<unsigned, unsigned>;
+/// The position of a compilation on the command line: the index of the archive (0 for the
+/// ticket files) and the index of the member within it. The two are packed into a single integer
+/// with the archive in the high half so that positions are ordered by one integer comparison.
+struct arch_position {
+    constexpr arch_position () noexcept = default;
+    constexpr arch_position (unsigned const archive, unsigned const member) noexcept
+            : v{(std::uint64_t{archive} << 32U) | member} {}
+
+    constexpr unsigned archive () const noexcept { return static_cast<unsigned> (v >> 32U); }
+    constexpr unsigned member () const noexcept { return static_cast<unsigned> (v); }
+
+    constexpr bool operator== (arch_position const rhs) const noexcept { return v == rhs.v; }
+    constexpr bool operator!= (arch_position const rhs) const noexcept { return v != rhs.v; }
+    constexpr bool operator< (arch_position const rhs) const noexcept { return v < rhs.v; }
+
+    std::uint64_t v = 0U;
+};
 
 inline std::ostream & operator<< (std::ostream & os, arch_position const & position) {
-    return os << '(' << position.first << ',' << position.second << ')';
+    return os << '(' << position.archive () << ',' << position.member () << ')';
 }
 
+/// The origins (file and archive member names) of the compilations named on the command line.
+/// Each distinct origin is stored once; a compilationref records its index rather than a copy of
+/// the string. Origins are interned while the link inputs are enumerated; lookups may then be
+/// made from any thread.
+class origin_table {
+public:
+    using index = std::uint32_t;
+
+    static origin_table & get ();
+
+    /// Returns the index of \p origin, adding it to the table if necessary.
+    index intern (std::string const & origin);
+    std::string const & operator[] (index const i) const noexcept { return strings_[i]; }
+    std::size_t size () const noexcept { return strings_.size (); }
+
+private:
+    origin_table () = default;
+
+    std::mutex mutex_;
+    /// A deque never moves its elements, so the keys of indices_ remain valid.
+    std::deque<std::string> strings_;
+    std::unordered_map<std::string_view, index> indices_;
+};
+
 struct compilationref {
-    explicit compilationref (digest const compilation_, std::string origin_,
+    explicit compilationref (digest const compilation_, origin_table::index const origin_,
                              arch_position const position_) noexcept
             : compilation{compilation_}
-            , origin{std::move (origin_)}
-            , position{position_} {}
+            , position{position_}
+            , origin_index{origin_} {}
+    /// Interns \p origin_.
+    compilationref (digest const compilation_, std::string const & origin_,
+                    arch_position const position_)
+            : compilationref{compilation_, origin_table::get ().intern (origin_), position_} {}
+
+    std::string const & origin () const noexcept { return origin_table::get ()[origin_index]; }
 
     digest const compilation;
-    std::string const origin;
     arch_position const position;
+    origin_table::index const origin_index;
 };
 
 #endif // COMPILATIONREF_HPP
@@ -0,0 +1,82 @@
+#ifndef CONCURRENT_ARRAY_HPP
+#define CONCURRENT_ARRAY_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/// An array of value-initialized elements with stable addresses whose storage is allocated on
+/// demand in fixed-size segments. Any number of threads may access elements concurrently: the
+/// first access to a segment allocates it with a single compare-exchange. Synchronization of the
+/// element values themselves is the responsibility of the caller.
+///
+/// \tparam T  The element type. Must be default-constructible.
+/// \tparam SegmentBits  log2 of the number of elements in each segment.
+/// \tparam IndexBits  log2 of the maximum number of elements.
+template <typename T, unsigned SegmentBits = 16U, unsigned IndexBits = 32U>
+class concurrent_array {
+public:
+    static_assert (SegmentBits <= IndexBits);
+    static constexpr auto segment_size = std::size_t{1} << SegmentBits;
+    static constexpr auto max_segments = std::size_t{1} << (IndexBits - SegmentBits);
+    static constexpr auto max_size = std::uint64_t{1} << IndexBits;
+
+    concurrent_array ()
+            : segments_{new std::atomic<T *>[max_segments] ()} {}
+    concurrent_array (concurrent_array const &) = delete;
+    concurrent_array (concurrent_array &&) = delete;
+    ~concurrent_array () noexcept {
+        for (auto index = std::size_t{0}; index < max_segments; ++index) {
+            delete[] segments_[index].load (std::memory_order_relaxed);
+        }
+    }
+
+    concurrent_array & operator= (concurrent_array const &) = delete;
+    concurrent_array & operator= (concurrent_array &&) = delete;
+
+    /// Returns the element at \p index allocating its segment if necessary.
+    T & operator[] (std::uint64_t const index) {
+        assert (index < max_size);
+        std::atomic<T *> & slot = segments_[index >> SegmentBits];
+        T * segment = slot.load (std::memory_order_acquire);
+        if (segment == nullptr) {
+            segment = this->allocate_segment (slot);
+        }
+        return segment[index & (segment_size - 1U)];
+    }
+    /// Returns the element at \p index. The segment must have been previously allocated.
+    T const & operator[] (std::uint64_t const index) const noexcept {
+        assert (index < max_size);
+        T const * const segment = segments_[index >> SegmentBits].load (std::memory_order_acquire);
+        assert (segment != nullptr);
+        return segment[index & (segment_size - 1U)];
+    }
+
+    /// Returns the number of bytes of element storage that have been allocated.
+    std::size_t bytes_allocated () const noexcept {
+        auto count = std::size_t{0};
+        for (auto index = std::size_t{0}; index < max_segments; ++index) {
+            if (segments_[index].load (std::memory_order_relaxed) != nullptr) {
+                ++count;
+            }
+        }
+        return count * segment_size * sizeof (T);
+    }
+
+private:
+    T * allocate_segment (std::atomic<T *> & slot) {
+        auto fresh = std::unique_ptr<T[]>{new T[segment_size] ()};
+        T * expected = nullptr;
+        if (slot.compare_exchange_strong (expected, fresh.get (), std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+            return fresh.release ();
+        }
+        return expected; // Another thread won the race.
+    }
+
+    std::unique_ptr<std::atomic<T *>[]> segments_;
+};
+
+#endif // CONCURRENT_ARRAY_HPP
@@ -1,36 +1,52 @@
 #ifndef CONTEXT_HPP
 #define CONTEXT_HPP
 
+#include <algorithm>
 #include <atomic>
-#include <list>
-#include <mutex>
-#include <vector>
+#include <cassert>
+#include <memory>
+#include <string_view>
 
 #include "compilationref.hpp"
+#include "concurrent_array.hpp"
 #include "repo.hpp"
+#include "shadow_memory.hpp"
 #include "symbol.hpp"
 
 struct context {
+    /// \param build_repository  A function which returns the repository to be linked as a
+    ///   std::unique_ptr<repository_view const>.
+    /// \param shadow_kind  The allocator used for shadow memory.
+    /// \param min_shadow_size  The minimum size of the shadow memory region. Allows a small
+    ///   repository to emulate the shadow memory footprint of a large one.
     template <typename RepoBuilderFn>
-    explicit context (RepoBuilderFn const build_repository)
+    explicit context (RepoBuilderFn const build_repository,
+                      shadow_memory::backend const shadow_kind = shadow_memory::default_backend (),
+                      std::size_t const min_shadow_size = 0U)
             : repo{build_repository ()}
-            , shadow (repo.size) {}
+            , shadow{std::max (repo->extent (), min_shadow_size), shadow_kind} {}
 
     auto shadow_pointer (address const address) noexcept {
         assert (shadow.size () >= address.raw () + sizeof (void *));
         return reinterpret_cast<std::atomic<void *> *> (shadow.data () + address.raw ());
     }
 
-    std::string name (address n) const { return repo.names.find (n)->second; }
+    /// The inverse of shadow_pointer(): returns the address shadowed by \p p.
+    address shadow_address (std::atomic<void *> const * const p) const noexcept {
+        auto const offset = reinterpret_cast<std::uint8_t const *> (p) - shadow.data ();
+        assert (offset >= 0 && static_cast<std::size_t> (offset) < shadow.size ());
+        return address{static_cast<std::uintptr_t> (offset)};
+    }
 
-    repository repo;
-    std::vector<uint8_t> shadow;
+    std::string_view name (address n) const { return repo->name (n); }
 
-    std::mutex symbols_mutex;
-    std::list<symbol> symbols;
+    std::unique_ptr<repository_view const> repo;
+    shadow_memory shadow;
 
-    std::mutex compilationrefs_mutex;
-    std::list<compilationref> compilationrefs;
+    symbol_table symbols;
+    /// The compilation assigned to each ordinal. An entry is written before the compilation is
+    /// submitted for symbol resolution.
+    concurrent_array<compilationref const *> files_by_ordinal;
     undefined_symbols undefs;
 };
 
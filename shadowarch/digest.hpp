@@ -0,0 +1,39 @@
+#ifndef DIGEST_HPP
+#define DIGEST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+struct digest {
+    constexpr bool operator== (digest const rhs) const noexcept { return v == rhs.v; }
+    constexpr bool operator!= (digest const rhs) const noexcept { return !operator== (rhs); }
+
+    std::uint64_t v;
+};
+
+inline std::ostream & operator<< (std::ostream & os, digest const d) {
+    return os << d.v;
+}
+
+/// The initial value of an FNV-1a hash.
+constexpr std::uint64_t fnv1a_basis = UINT64_C (0xcbf29ce484222325);
+
+/// The FNV-1a hash of \p size bytes at \p p combined with \p h. Used to compute digests of
+/// link inputs which are saved to disk, so the result must not change.
+inline std::uint64_t fnv1a (std::uint64_t h, void const * const p,
+                           std::size_t const size) noexcept {
+    auto const * const bytes = static_cast<std::uint8_t const *> (p);
+    for (auto ctr = std::size_t{0}; ctr < size; ++ctr) {
+        h = (h ^ bytes[ctr]) * UINT64_C (0x100000001b3);
+    }
+    return h;
+}
+
+template <>
+struct std::hash<digest> {
+    std::size_t operator() (digest d) const noexcept { return std::hash<decltype (d.v)>{}(d.v); }
+};
+
+#endif // DIGEST_HPP
@@ -0,0 +1,59 @@
+#include "digest_index.hpp"
+
+#include <cassert>
+
+namespace {
+
+    constexpr auto min_capacity = std::size_t{8};
+
+    constexpr digest_index::slot empty_slot{digest{0}, digest_index::npos, 0U};
+
+} // end anonymous namespace
+
+digest_index::digest_index (std::size_t const expected_size)
+        : slots_ (capacity_for (expected_size), empty_slot) {}
+
+std::size_t digest_index::capacity_for (std::size_t const size) noexcept {
+    auto capacity = min_capacity;
+    while (capacity < size * 2U) {
+        capacity *= 2U;
+    }
+    return capacity;
+}
+
+bool digest_index::insert (digest const key, std::uint32_t const value) {
+    assert (value != npos && "npos is reserved to mark empty slots");
+    if (this->find (key) != npos) {
+        return false;
+    }
+    this->reserve (size_ + 1U);
+    place (slots_, key, value);
+    ++size_;
+    return true;
+}
+
+void digest_index::place (std::vector<slot> & slots, digest const key,
+                          std::uint32_t const value) noexcept {
+    auto const mask = slots.size () - 1U;
+    auto index = static_cast<std::size_t> (mix (key)) & mask;
+    while (slots[index].value != npos) {
+        index = (index + 1U) & mask;
+    }
+    slots[index] = slot{key, value, 0U};
+}
+
+void digest_index::reserve (std::size_t const size) {
+    if (slots_.size () < capacity_for (size)) {
+        this->rehash (capacity_for (size));
+    }
+}
+
+void digest_index::rehash (std::size_t const capacity) {
+    std::vector<slot> slots (capacity, empty_slot);
+    for (slot const & s : slots_) {
+        if (s.value != npos) {
+            place (slots, s.key, s.value);
+        }
+    }
+    slots_.swap (slots);
+}
@@ -0,0 +1,98 @@
+#ifndef DIGEST_INDEX_HPP
+#define DIGEST_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "digest.hpp"
+#include "span.hpp"
+
+/// A flat, open-addressing hash table which maps digests to 32-bit values (typically indices
+/// into a separate array of records). The index is built once before a link starts and is then
+/// only read, so it supports insertion but not erasure.
+///
+/// Slots are stored contiguously and probed linearly. Digests are passed through a finalizer
+/// before being reduced to a slot number: neighbouring digest values (as well as any which
+/// differ only in their high bits) are scattered across the table. The load factor is kept at or
+/// below 1/2 so that a lookup usually touches a single cache line.
+///
+/// The slot array has a fixed layout so that it can also be written to, and probed in place
+/// from, a repository file (see lookup()).
+class digest_index {
+public:
+    /// The value returned by find() for a digest which is not in the index. It is also the value
+    /// stored in an empty slot.
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max ();
+
+    struct slot {
+        digest key;
+        std::uint32_t value;
+        std::uint32_t padding;
+    };
+
+    digest_index () = default;
+    /// \param expected_size  The number of entries that will be inserted. The table does not
+    ///   need to grow until this number is exceeded.
+    explicit digest_index (std::size_t expected_size);
+
+    /// Allocates enough slots to hold \p size entries without further growth.
+    void reserve (std::size_t size);
+
+    /// Adds \p key to the index with value \p value.
+    /// \returns False (and leaves the index unchanged) if \p key was already present.
+    bool insert (digest key, std::uint32_t value);
+
+    /// Returns the value associated with \p key or npos if it is not present.
+    std::uint32_t find (digest const key) const noexcept {
+        return lookup (span<slot const>{slots_.data (), slots_.size ()}, key);
+    }
+
+    std::size_t size () const noexcept { return size_; }
+    bool empty () const noexcept { return size_ == 0U; }
+    /// The raw slot array. Its size is always zero or a power of two.
+    span<slot const> slots () const noexcept { return {slots_.data (), slots_.size ()}; }
+
+    /// Searches an array of slots produced by a digest_index for \p key.
+    /// \param slots  An array of slots whose size is zero or a power of two.
+    /// \returns The value associated with \p key or npos if it is not present.
+    static std::uint32_t lookup (span<slot const> const slots, digest const key) noexcept {
+        if (slots.empty ()) {
+            return npos;
+        }
+        auto const mask = slots.size () - 1U;
+        for (auto index = static_cast<std::size_t> (mix (key)) & mask;;
+             index = (index + 1U) & mask) {
+            slot const & s = slots[index];
+            if (s.value == npos || s.key == key) {
+                return s.value;
+            }
+        }
+    }
+
+    /// The number of slots allocated for an index holding \p size entries.
+    static std::size_t capacity_for (std::size_t size) noexcept;
+
+    /// The MurmurHash3 64-bit finalizer.
+    static constexpr std::uint64_t mix (digest const d) noexcept {
+        auto x = d.v;
+        x ^= x >> 33U;
+        x *= UINT64_C (0xff51afd7ed558ccd);
+        x ^= x >> 33U;
+        x *= UINT64_C (0xc4ceb9fe1a85ec53);
+        x ^= x >> 33U;
+        return x;
+    }
+
+private:
+    /// Places \p key in the first free slot of its probe sequence. The key must not already be
+    /// present and the table must have at least one free slot.
+    static void place (std::vector<slot> & slots, digest key, std::uint32_t value) noexcept;
+    void rehash (std::size_t capacity);
+
+    std::vector<slot> slots_;
+    std::size_t size_ = 0U;
+};
+
+#endif // DIGEST_INDEX_HPP
@@ -0,0 +1,203 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace {
+
+    using rng_type = std::mt19937_64;
+
+    /// Returns a digest which is not yet used as a key by \p add.
+    template <typename AddFn>
+    digest unique_digest (rng_type & rng, AddFn add) {
+        for (;;) {
+            if (digest const d{rng ()}; add (d)) {
+                return d;
+            }
+        }
+    }
+
+    class fan_out_sampler {
+    public:
+        explicit fan_out_sampler (generator_params const & params)
+                : kind_{params.fan_out_distribution}
+                , fixed_{static_cast<unsigned> (std::lround (params.fan_out))}
+                , uniform_{0U, static_cast<unsigned> (std::lround (2.0 * params.fan_out))}
+                , geometric_{1.0 / (1.0 + params.fan_out)} {}
+
+        unsigned operator() (rng_type & rng) {
+            switch (kind_) {
+            case generator_params::distribution::fixed: return fixed_;
+            case generator_params::distribution::uniform: return uniform_ (rng);
+            case generator_params::distribution::geometric: return geometric_ (rng);
+            }
+            return 0U;
+        }
+
+    private:
+        generator_params::distribution kind_;
+        unsigned fixed_;
+        std::uniform_int_distribution<unsigned> uniform_;
+        std::geometric_distribution<unsigned> geometric_;
+    };
+
+} // end anonymous namespace
+
+std::optional<generator_params::distribution>
+generator_params::parse_distribution (std::string const & s) {
+    if (s == "fixed") {
+        return distribution::fixed;
+    }
+    if (s == "uniform") {
+        return distribution::uniform;
+    }
+    if (s == "geometric") {
+        return distribution::geometric;
+    }
+    return std::nullopt;
+}
+
+std::ostream & operator<< (std::ostream & os, generator_params::distribution const d) {
+    switch (d) {
+    case generator_params::distribution::fixed: return os << "fixed";
+    case generator_params::distribution::uniform: return os << "uniform";
+    case generator_params::distribution::geometric: return os << "geometric";
+    }
+    return os;
+}
+
+std::ostream & operator<< (std::ostream & os, generator_params const & p) {
+    return os << "seed=" << p.seed << " symbols=" << p.symbols
+              << " defs-per-compilation=" << p.definitions_per_compilation
+              << " fan-out=" << p.fan_out << " (" << p.fan_out_distribution << ')'
+              << " duplicates=" << p.duplicate_rate << " depth=" << p.depth
+              << " archives=" << p.archives << " edits=" << p.edits;
+}
+
+link_inputs generate (generator_params const & params) {
+    assert (params.depth > 0U && params.symbols >= params.depth);
+    assert (params.definitions_per_compilation > 0U);
+    assert (params.depth == 1U || params.archives > 0U);
+
+    rng_type rng{params.seed};
+    link_inputs result;
+    repository & repo = result.repo;
+
+    // Scatter the symbols' names across the address space so that neighbouring definitions do
+    // not have neighbouring shadow memory.
+    std::vector<std::size_t> slots (params.symbols);
+    std::iota (std::begin (slots), std::end (slots), std::size_t{0});
+    std::shuffle (std::begin (slots), std::end (slots), rng);
+    auto const address_of = [&slots] (std::size_t const symbol) {
+        return address{slots[symbol] * sizeof (address)};
+    };
+
+    repo.names.reserve (params.symbols);
+    for (auto symbol = std::size_t{0}; symbol < params.symbols; ++symbol) {
+        repo.names.emplace (address_of (symbol), "s" + std::to_string (symbol));
+    }
+    repo.size = params.symbols * sizeof (address);
+
+    // Layer n defines the symbols [layer_start (n), layer_start (n + 1)).
+    auto const layer_start = [&params] (unsigned const layer) {
+        return params.symbols * layer / params.depth;
+    };
+    auto const compilations_in = [&] (unsigned const layer) {
+        auto const symbols = layer_start (layer + 1U) - layer_start (layer);
+        return (symbols + params.definitions_per_compilation - 1U) /
+               params.definitions_per_compilation;
+    };
+    auto total_compilations = std::size_t{0};
+    for (auto layer = 0U; layer < params.depth; ++layer) {
+        total_compilations += compilations_in (layer);
+    }
+    repo.reserve (total_compilations, params.symbols);
+
+    // The symbols which may be referenced by fragments in each layer.
+    auto const targets = [&] (unsigned const layer) {
+        if (layer + 1U < params.depth) {
+            return std::uniform_int_distribution<std::size_t>{layer_start (layer + 1U),
+                                                              layer_start (layer + 2U) - 1U};
+        }
+        auto const last = params.depth == 1U ? params.symbols : layer_start (layer);
+        return std::uniform_int_distribution<std::size_t>{0U, last - 1U};
+    };
+
+    fan_out_sampler fan_out{params};
+    std::vector<digest> tickets;
+    std::vector<digest> members;
+    for (auto layer = 0U; layer < params.depth; ++layer) {
+        auto target = targets (layer);
+        auto const last = layer_start (layer + 1U);
+        for (auto symbol = layer_start (layer); symbol < last;) {
+            std::vector<compilation::definition> definitions;
+            for (auto const end = std::min (last, symbol + params.definitions_per_compilation);
+                 symbol < end; ++symbol) {
+                std::vector<address> references (fan_out (rng));
+                std::generate (std::begin (references), std::end (references),
+                               [&] { return address_of (target (rng)); });
+                ::fragment f{std::move (references)};
+                digest const fragment = unique_digest (
+                    rng, [&] (digest const d) { return repo.add (d, std::move (f)); });
+                definitions.emplace_back (address_of (symbol), fragment);
+            }
+            ::compilation c{std::move (definitions)};
+            digest const compilation =
+                unique_digest (rng, [&] (digest const d) { return repo.add (d, std::move (c)); });
+            (layer == 0U ? tickets : members).push_back (compilation);
+        }
+    }
+
+    // Distribute the archive members among the archives. A duplicated member is placed in a
+    // second, different, archive.
+    std::vector<std::vector<std::size_t>> archives (params.archives);
+    std::uniform_int_distribution<unsigned> pick_archive{0U, std::max (params.archives, 1U) - 1U};
+    std::bernoulli_distribution duplicate{params.archives > 1U ? params.duplicate_rate : 0.0};
+    for (auto member = std::size_t{0}; member < members.size (); ++member) {
+        auto const a = pick_archive (rng);
+        archives[a].push_back (member);
+        if (duplicate (rng)) {
+            auto b = pick_archive (rng);
+            while (b == a) {
+                b = pick_archive (rng);
+            }
+            archives[b].push_back (member);
+        }
+    }
+    for (auto a = 0U; a < params.archives; ++a) {
+        std::sort (std::begin (archives[a]), std::end (archives[a]));
+        auto const library = "lib" + std::to_string (a) + ".a(m";
+        for (auto y = 0U; y < archives[a].size (); ++y) {
+            auto const member = archives[a][y];
+            result.members.emplace_back (members[member],
+                                         library + std::to_string (member) + ".o)",
+                                         arch_position{a + 1U, y});
+        }
+    }
+
+    // The edits are made last so that the rest of the link is the same with or without them.
+    auto const edits = std::min (std::size_t{params.edits}, tickets.size ());
+    for (auto ticket = std::size_t{0}; ticket < edits; ++ticket) {
+        std::vector<compilation::definition> definitions;
+        for (auto const & definition : repo.definitions (tickets[ticket])) {
+            span<address const> const refs = repo.references (definition.fragment);
+            std::vector<address> references{std::begin (refs), std::end (refs)};
+            std::reverse (std::begin (references), std::end (references));
+            ::fragment f{std::move (references)};
+            digest const fragment =
+                unique_digest (rng, [&] (digest const d) { return repo.add (d, std::move (f)); });
+            definitions.emplace_back (definition.name, fragment);
+        }
+        ::compilation c{std::move (definitions)};
+        tickets[ticket] =
+            unique_digest (rng, [&] (digest const d) { return repo.add (d, std::move (c)); });
+    }
+    for (auto index = 0U; index < tickets.size (); ++index) {
+        result.tickets.emplace_back (tickets[index], "t" + std::to_string (index) + ".o",
+                                     arch_position{0U, index});
+    }
+    return result;
+}
@@ -0,0 +1,69 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "compilationref.hpp"
+#include "repo.hpp"
+
+/// The parameters of a synthetic link. The same parameters (including the seed) always produce
+/// the same repository and archive layout.
+struct generator_params {
+    /// The shape of the distribution from which the number of references made by each fragment
+    /// is drawn. Each has a mean of generator_params::fan_out.
+    enum class distribution {
+        fixed,     ///< Every fragment makes exactly fan_out references.
+        uniform,   ///< Uniform over [0, 2 * fan_out].
+        geometric, ///< Geometric: most fragments make few references; a few make many.
+    };
+
+    std::uint64_t seed = 1U;
+    /// The total number of symbols defined by the repository.
+    std::size_t symbols = 10'000U;
+    /// The number of definitions made by each compilation.
+    unsigned definitions_per_compilation = 4U;
+    /// The mean number of references made by each fragment.
+    double fan_out = 2.0;
+    distribution fan_out_distribution = distribution::geometric;
+    /// The probability that an archive member is also present in a second archive. Only the copy
+    /// with the lower archive position may be linked.
+    double duplicate_rate = 0.05;
+    /// The number of symbol resolution groups needed to complete the link.
+    unsigned depth = 4U;
+    /// The number of archives among which the non-ticket compilations are distributed.
+    unsigned archives = 16U;
+    /// The number of ticket compilations whose fragments are edited after the link is generated.
+    /// An edit leaves the names defined and referenced by a ticket unchanged but gives the
+    /// compilation a new digest, as a change to the body of a function would.
+    unsigned edits = 0U;
+
+    static std::optional<distribution> parse_distribution (std::string const & s);
+};
+
+std::ostream & operator<< (std::ostream & os, generator_params::distribution d);
+std::ostream & operator<< (std::ostream & os, generator_params const & p);
+
+/// The inputs to a link: a repository and the files named on the command line.
+struct link_inputs {
+    repository repo;
+    /// Compilations named on the command line: ordinal order, archive position 0.
+    std::vector<compilationref> tickets;
+    /// Archive members in command-line order. Positions start at 1.
+    std::vector<compilationref> members;
+};
+
+/// Generates a repository and archive layout with the given parameters.
+///
+/// The symbols are divided evenly into params.depth layers. Layer 0 is defined by the ticket
+/// files; the remaining layers are defined by archive members. The fragments defined in layer n
+/// reference symbols from layer n+1 so that each layer is pulled into the link by the symbol
+/// resolution group before it. Fragments in the final layer reference symbols from the earlier
+/// layers, all of which are defined by then.
+link_inputs generate (generator_params const & params);
+
+#endif // GENERATOR_HPP
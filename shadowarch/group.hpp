@@ -1,36 +1,74 @@
 #ifndef GROUP_HPP
 #define GROUP_HPP
 
-#include <mutex>
-#include <unordered_set>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
 
+#include "concurrent_array.hpp"
+#include "per_thread.hpp"
 #include "repo.hpp"
 
+/// The set of shadow memory pointers whose compilations will form the next group. Each worker
+/// appends to its own buffer without locking. Duplicates are filtered by a claim bit for each
+/// shadow memory slot which the first inserting thread sets with a single atomic operation.
 class group_set {
 public:
+    /// \param shadow_base  The start of the shadow memory region.
+    explicit group_set (void const * const shadow_base) noexcept
+            : base_{reinterpret_cast<std::uintptr_t> (shadow_base)} {}
+
     void insert (std::atomic<void *> * const ref) {
-        std::lock_guard<std::mutex> _{mutex_};
-        m_.insert (ref);
+        auto const bit = this->slot (ref);
+        auto const mask = std::uint64_t{1} << (bit % 64U);
+        if ((claimed_[bit / 64U].fetch_or (mask, std::memory_order_relaxed) & mask) != 0U) {
+            return; // Already a member of the set.
+        }
+        buffers_.local ().push_back (ref);
     }
 
+    /// Empties the set. Must not be called concurrently with insert().
+    /// \returns True if the set was not empty.
     bool clear () {
-        std::lock_guard<std::mutex> _{mutex_};
-        bool more = !m_.empty ();
-        m_.clear ();
+        bool more = false;
+        buffers_.for_each ([this, &more] (std::thread::id, buffer & b) {
+            more = more || !b.empty ();
+            for (std::atomic<void *> * const ref : b) {
+                auto const bit = this->slot (ref);
+                claimed_[bit / 64U].fetch_and (~(std::uint64_t{1} << (bit % 64U)),
+                                               std::memory_order_relaxed);
+            }
+            b.clear ();
+        });
         return more;
     }
 
+    /// Calls \p function (std::atomic<void *> *) for each member of the set. Must not be called
+    /// concurrently with insert().
     template <typename Function>
     void for_each (Function function) {
-        std::lock_guard<std::mutex> _{mutex_};
-        for (auto const & s : m_) {
-            function (s);
-        }
+        buffers_.for_each ([&function] (std::thread::id, buffer const & b) {
+            for (std::atomic<void *> * const ref : b) {
+                function (ref);
+            }
+        });
     }
 
 private:
-    std::unordered_set<std::atomic<void *> *> m_;
-    std::mutex mutex_;
+    using buffer = std::vector<std::atomic<void *> *>;
+
+    /// Returns the index of the shadow memory slot occupied by \p ref.
+    std::uint64_t slot (std::atomic<void *> const * const ref) const noexcept {
+        auto const offset = reinterpret_cast<std::uintptr_t> (ref) - base_;
+        assert (offset % sizeof (void *) == 0U && "Shadow pointers must be aligned");
+        return offset / sizeof (void *);
+    }
+
+    std::uintptr_t const base_;
+    /// One claim bit for each pointer-sized slot in shadow memory.
+    concurrent_array<std::atomic<std::uint64_t>> claimed_;
+    per_thread<buffer> buffers_;
 };
 
 #endif // GROUP_HPP
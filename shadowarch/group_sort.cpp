@@ -0,0 +1,119 @@
+#include "group_sort.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+#include "compilationref.hpp"
+#include "task_pool.hpp"
+#include "timeline.hpp"
+
+namespace {
+
+    constexpr auto digit_bits = 11U;
+    constexpr auto radix = std::size_t{1} << digit_bits;
+    /// The number of compilations counted or scattered by each task.
+    constexpr auto block_size = std::size_t{1} << 15U;
+
+    struct keyed {
+        std::uint64_t key;
+        compilationref * cr;
+    };
+
+    unsigned bit_width (std::uint64_t v) noexcept {
+        auto result = 0U;
+        for (; v != 0U; v >>= 1U) {
+            ++result;
+        }
+        return result;
+    }
+
+    /// Calls \p function (first, last) for each block of [0, size), running the blocks
+    /// concurrently if there is more than one.
+    template <typename Function>
+    void for_each_block (task_pool & pool, std::size_t const size, Function const & function) {
+        if (size <= block_size) {
+            function (std::size_t{0}, size);
+            return;
+        }
+        task_group tasks;
+        for (auto first = std::size_t{0}; first < size; first += block_size) {
+            pool.submit (tasks, [&function, first, size] {
+                function (first, std::min (first + block_size, size));
+            });
+        }
+        tasks.wait ();
+    }
+
+} // end anonymous namespace
+
+void sort_group (std::vector<compilationref *> & group, task_pool & pool) {
+    timeline::scope const _{"sort group", "compilations", group.size ()};
+    auto const size = group.size ();
+    if (size < 2U) {
+        return;
+    }
+
+    // Repack each position into a key with no unused bits between the archive and member indices
+    // so that the sort needs as few passes as possible.
+    auto max_archive = 0U;
+    auto max_member = 0U;
+    for (compilationref const * const cr : group) {
+        max_archive = std::max (max_archive, cr->position.archive ());
+        max_member = std::max (max_member, cr->position.member ());
+    }
+    auto const member_bits = bit_width (max_member);
+    auto const key_bits = member_bits + bit_width (max_archive);
+    assert (key_bits <= 64U);
+
+    std::vector<keyed> in (size);
+    std::vector<keyed> out (size);
+    for_each_block (pool, size, [&] (std::size_t const first, std::size_t const last) {
+        for (auto ctr = first; ctr < last; ++ctr) {
+            compilationref * const cr = group[ctr];
+            in[ctr] = keyed{(std::uint64_t{cr->position.archive ()} << member_bits) |
+                                cr->position.member (),
+                            cr};
+        }
+    });
+
+    // counts[b][d] is first the number of keys in block b with digit d and then the index in
+    // 'out' of the next of them.
+    std::vector<std::array<std::size_t, radix>> counts ((size + block_size - 1U) / block_size);
+    for (auto shift = 0U; shift < key_bits; shift += digit_bits) {
+        auto const digit = [shift] (keyed const & k) {
+            return static_cast<std::size_t> ((k.key >> shift) & (radix - 1U));
+        };
+        for_each_block (pool, size, [&] (std::size_t const first, std::size_t const last) {
+            auto & c = counts[first / block_size];
+            c.fill (0U);
+            for (auto ctr = first; ctr < last; ++ctr) {
+                ++c[digit (in[ctr])];
+            }
+        });
+        // An exclusive prefix sum taken in (digit, block) order keeps the sort stable.
+        auto total = std::size_t{0};
+        for (auto d = std::size_t{0}; d < radix; ++d) {
+            for (auto & c : counts) {
+                auto const count = c[d];
+                c[d] = total;
+                total += count;
+            }
+        }
+        for_each_block (pool, size, [&] (std::size_t const first, std::size_t const last) {
+            auto & c = counts[first / block_size];
+            for (auto ctr = first; ctr < last; ++ctr) {
+                out[c[digit (in[ctr])]++] = in[ctr];
+            }
+        });
+        in.swap (out);
+    }
+
+    group.clear ();
+    for (keyed const & k : in) {
+        if (group.empty () || group.back () != k.cr) {
+            group.push_back (k.cr);
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef GROUP_SORT_HPP
+#define GROUP_SORT_HPP
+
+#include <vector>
+
+struct compilationref;
+class task_pool;
+
+/// Sorts the compilations of a group by archive position and removes duplicates. Each archive
+/// member has a single compilationref, so a member which defines more than one of the undefined
+/// symbols appears once for each of them and the duplicate pointers are adjacent once sorted.
+///
+/// The positions are packed into integers and sorted with a stable LSD radix sort whose counting
+/// and scattering passes are split between the pool's workers. The resulting order, and hence the
+/// ordinals assigned to the group, depends only on the positions.
+void sort_group (std::vector<compilationref *> & group, task_pool & pool);
+
+#endif // GROUP_SORT_HPP
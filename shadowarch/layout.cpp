@@ -0,0 +1,43 @@
+#include "layout.hpp"
+
+#include <thread>
+
+#include "Visited.h"
+#include "context.hpp"
+#include "print.hpp"
+#include "timeline.hpp"
+
+namespace {
+
+    /// The pretend size of a fragment: a fixed-size body plus a relocation for each reference.
+    std::uint64_t fragment_size (span<address const> const & references) noexcept {
+        return 16U + references.size () * sizeof (address);
+    }
+
+} // end anonymous namespace
+
+layout_result layout (context & context, Visited & visited,
+                      std::chrono::duration<double> const delay) {
+    // Take as many ready files at a time as we can to minimize the number of wake-ups.
+    constexpr auto max_batch = 64U;
+
+    repository_view const & repo = *context.repo;
+    layout_result result;
+    timeline::recorder::get ().name_thread ("layout");
+    while (std::optional<Visited::Range> const range = visited.nextRange (max_batch)) {
+        timeline::scope const batch{"layout batch", "first", range->First};
+        for (auto ordinal = range->First; ordinal < range->Last; ++ordinal) {
+            compilationref const * const cr = context.files_by_ordinal[ordinal];
+            std::this_thread::sleep_for (delay);
+
+            auto const start = result.size;
+            for (auto const & definition : repo.definitions (cr->compilation)) {
+                result.size += fragment_size (repo.references (definition.fragment));
+            }
+            RLD_TRACE ("Layout ordinal ", ordinal, " (origin=\"", cr->origin (), "\") at [",
+                       start, ',', result.size, ')');
+            ++result.files;
+        }
+    }
+    return result;
+}
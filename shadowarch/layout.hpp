@@ -0,0 +1,27 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include <chrono>
+#include <cstdint>
+
+class Visited;
+struct context;
+
+struct layout_result {
+    /// The number of files laid out.
+    unsigned files = 0U;
+    /// The total size of the output.
+    std::uint64_t size = 0U;
+};
+
+/// The layout stage. Consumes file ordinals from \p visited in order and assigns an output
+/// offset to each of the definitions in the corresponding compilation. Returns once \p visited
+/// signals that there are no more files.
+///
+/// \param context  The link context. Its files_by_ordinal member must have an entry for each
+///   ordinal produced by \p visited.
+/// \param visited  The sequencer through which symbol resolution reports completed files.
+/// \param delay  An artificial delay per file used to simulate the work of copying its data.
+layout_result layout (context & context, Visited & visited, std::chrono::duration<double> delay);
+
+#endif // LAYOUT_HPP
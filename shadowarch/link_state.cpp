@@ -0,0 +1,326 @@
+#include "link_state.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+#include "context.hpp"
+#include "digest.hpp"
+#include "shadow.hpp"
+#include "symbol.hpp"
+
+namespace {
+
+    static_assert (sizeof (address) == 8U && sizeof (digest) == 8U,
+                   "The link state file format requires 64-bit addresses and digests");
+    static_assert (sizeof (link_state::file_entry) == 40U &&
+                   std::is_trivially_copyable_v<link_state::file_entry>);
+
+    constexpr auto unreached = ~0U;
+
+    std::uint64_t fnv1a (std::uint64_t h, compilationref const & cr,
+                         bool const include_compilation) noexcept {
+        if (include_compilation) {
+            h = ::fnv1a (h, &cr.compilation, sizeof (cr.compilation));
+        }
+        std::uint32_t const position[] = {cr.position.archive (), cr.position.member ()};
+        h = ::fnv1a (h, position, sizeof (position));
+        std::string const & origin = cr.origin ();
+        return ::fnv1a (h, origin.data (), origin.size () + 1U);
+    }
+
+    std::vector<address> sorted (std::vector<address> v) {
+        std::sort (std::begin (v), std::end (v),
+                   [] (address const a, address const b) { return a.v < b.v; });
+        return v;
+    }
+
+    template <typename T>
+    void write_array (std::ofstream & os, T const * const data, std::size_t const size) {
+        os.write (reinterpret_cast<char const *> (data),
+                  static_cast<std::streamsize> (size * sizeof (T)));
+    }
+
+    [[noreturn]] void invalid (std::string const & path, char const * const what) {
+        throw std::runtime_error{path + ": " + what};
+    }
+
+} // end anonymous namespace
+
+namespace link_state {
+
+    std::uint64_t fingerprint (std::vector<compilationref> const & tickets,
+                               std::vector<compilationref> const & members) {
+        auto h = fnv1a_basis;
+        for (compilationref const & cr : tickets) {
+            h = fnv1a (h, cr, false);
+        }
+        for (compilationref const & cr : members) {
+            h = fnv1a (h, cr, true);
+        }
+        return h;
+    }
+
+    file make_file (repository_view const & repo, compilationref const & cr,
+                    unsigned const group) {
+        file f{cr.compilation, cr.position, group, cr.origin (), {}, {}};
+        for (auto const & definition : repo.definitions (cr.compilation)) {
+            f.definitions.push_back (definition.name);
+            span<address const> const references = repo.references (definition.fragment);
+            f.references.insert (std::end (f.references), std::begin (references),
+                                 std::end (references));
+        }
+        f.references = sorted (std::move (f.references));
+        f.references.erase (std::unique (std::begin (f.references), std::end (f.references)),
+                            std::end (f.references));
+        return f;
+    }
+
+    std::optional<std::vector<unsigned>> changed_files (state const & previous,
+                                                        std::uint64_t const inputs,
+                                                        std::vector<compilationref> const & tickets,
+                                                        repository_view const & repo,
+                                                        std::string & reason) {
+        if (previous.inputs != inputs || previous.files.size () < tickets.size ()) {
+            reason = "the archives or command line have changed";
+            return std::nullopt;
+        }
+        if (previous.undefined > 0U) {
+            reason = "the previous link left undefined symbols";
+            return std::nullopt;
+        }
+        // The tickets form group 0 and so have the first ordinals.
+        std::vector<unsigned> changed;
+        for (auto ordinal = 0U; ordinal < tickets.size (); ++ordinal) {
+            if (previous.files[ordinal].compilation != tickets[ordinal].compilation) {
+                changed.push_back (ordinal);
+            }
+        }
+        if (changed.empty ()) {
+            return changed;
+        }
+
+        // Describe the tickets as they are now.
+        std::vector<file> after;
+        after.reserve (changed.size ());
+        for (unsigned const ordinal : changed) {
+            after.push_back (make_file (repo, tickets[ordinal], 0U));
+            file const & before = previous.files[ordinal];
+            if (sorted (after.back ().definitions) != sorted (before.definitions)) {
+                reason = before.origin + " defines different symbols";
+                return std::nullopt;
+            }
+        }
+
+        // The ordinal of the file which defines each name referenced by the changed tickets, now
+        // or before. Scanning the definitions for this small set of names is much cheaper than
+        // building a map of every name in the link.
+        std::unordered_map<address, unsigned> owners;
+        for (auto index = std::size_t{0}; index < changed.size (); ++index) {
+            for (address const name : after[index].references) {
+                owners.emplace (name, unreached);
+            }
+            for (address const name : previous.files[changed[index]].references) {
+                owners.emplace (name, unreached);
+            }
+        }
+        for (auto ordinal = 0U; ordinal < previous.files.size (); ++ordinal) {
+            for (address const name : previous.files[ordinal].definitions) {
+                if (auto const pos = owners.find (name); pos != std::end (owners)) {
+                    pos->second = ordinal;
+                }
+            }
+        }
+
+        // References to the names defined by archive members are the ones which pull members
+        // into the link.
+        auto const member_references = [&] (std::vector<address> const & refs) {
+            std::vector<address> result;
+            for (address const name : refs) {
+                unsigned const owner = owners.find (name)->second;
+                if (owner == unreached) {
+                    return std::optional<std::vector<address>>{};
+                }
+                if (previous.files[owner].position.archive () != 0U) {
+                    result.push_back (name);
+                }
+            }
+            return std::optional<std::vector<address>>{std::move (result)};
+        };
+        bool members_affected = false;
+        for (auto index = std::size_t{0}; index < changed.size (); ++index) {
+            file const & before = previous.files[changed[index]];
+            std::optional<std::vector<address>> const now =
+                member_references (after[index].references);
+            if (!now) {
+                reason = before.origin + " references a symbol not defined by the previous link";
+                return std::nullopt;
+            }
+            members_affected = members_affected || now != member_references (before.references);
+        }
+        if (!members_affected) {
+            return changed;
+        }
+
+        // Walk the graph of references breadth-first from the tickets to find the group in
+        // which a full link would resolve each file.
+        auto const references_of = [&] (unsigned const ordinal) -> std::vector<address> const & {
+            auto const pos = std::lower_bound (std::begin (changed), std::end (changed), ordinal);
+            if (pos != std::end (changed) && *pos == ordinal) {
+                return after[static_cast<std::size_t> (pos - std::begin (changed))].references;
+            }
+            return previous.files[ordinal].references;
+        };
+        for (auto ordinal = 0U; ordinal < previous.files.size (); ++ordinal) {
+            for (address const name : previous.files[ordinal].definitions) {
+                owners[name] = ordinal;
+            }
+        }
+        std::vector<unsigned> groups (previous.files.size (), unreached);
+        std::vector<unsigned> frontier (tickets.size ());
+        for (auto ordinal = 0U; ordinal < tickets.size (); ++ordinal) {
+            groups[ordinal] = 0U;
+            frontier[ordinal] = ordinal;
+        }
+        for (auto group = 1U; !frontier.empty (); ++group) {
+            std::vector<unsigned> next;
+            for (unsigned const ordinal : frontier) {
+                for (address const name : references_of (ordinal)) {
+                    unsigned const owner = owners.find (name)->second;
+                    if (groups[owner] == unreached) {
+                        groups[owner] = group;
+                        next.push_back (owner);
+                    }
+                }
+            }
+            frontier = std::move (next);
+        }
+        for (auto ordinal = 0U; ordinal < previous.files.size (); ++ordinal) {
+            if (groups[ordinal] != previous.files[ordinal].group) {
+                reason = "the archive members needed by the link have changed";
+                return std::nullopt;
+            }
+        }
+        return changed;
+    }
+
+    void restore (state const & previous, std::vector<unsigned> const & changed,
+                  std::vector<compilationref> const & tickets,
+                  std::vector<compilationref> const & members, context & context) {
+        std::vector<compilationref const *> by_position;
+        by_position.reserve (members.size ());
+        for (compilationref const & cr : members) {
+            by_position.push_back (&cr);
+        }
+        auto const less = [] (compilationref const * const a, compilationref const * const b) {
+            return a->position < b->position;
+        };
+        std::sort (std::begin (by_position), std::end (by_position), less);
+
+        for (auto ordinal = 0U; ordinal < previous.files.size (); ++ordinal) {
+            file const & f = previous.files[ordinal];
+            if (f.position.archive () == 0U) {
+                assert (f.position.member () < tickets.size ());
+                context.files_by_ordinal[ordinal] = &tickets[f.position.member ()];
+            } else {
+                compilationref const key{f.compilation, std::string{}, f.position};
+                auto const pos =
+                    std::lower_bound (std::begin (by_position), std::end (by_position), &key, less);
+                assert (pos != std::end (by_position) && (*pos)->position == f.position);
+                context.files_by_ordinal[ordinal] = *pos;
+            }
+
+            bool const again =
+                std::binary_search (std::begin (changed), std::end (changed), ordinal);
+            for (address const name : f.definitions) {
+                symbol_handle const sym =
+                    again ? new_symbol (context, name) : new_symbol (context, name, ordinal);
+                context.shadow_pointer (name)->store (
+                    shadow::tagged_pointer{sym}.as_void_pointer (), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<state> read (std::string const & path) {
+        std::ifstream is{path, std::ios::binary | std::ios::ate};
+        if (!is) {
+            return std::nullopt;
+        }
+        // Read the whole file at once: it holds many small arrays.
+        std::vector<char> contents (static_cast<std::size_t> (is.tellg ()));
+        is.seekg (0);
+        if (!is.read (contents.data (), static_cast<std::streamsize> (contents.size ()))) {
+            invalid (path, "could not read the file");
+        }
+        auto offset = std::size_t{0};
+        auto const take = [&] (void * const data, std::size_t const size) {
+            if (contents.size () - offset < size) {
+                invalid (path, "the file is truncated");
+            }
+            std::memcpy (data, contents.data () + offset, size);
+            offset += size;
+        };
+
+        header h{};
+        if (contents.size () < sizeof (h) ||
+            std::memcmp (contents.data (), header::magic_value, sizeof (h.magic)) != 0) {
+            invalid (path, "not a link state file");
+        }
+        take (&h, sizeof (h));
+        if (h.version != header::current_version) {
+            invalid (path, "unsupported link state version");
+        }
+        state s;
+        s.inputs = h.inputs;
+        s.undefined = h.undefined;
+        s.files.reserve (h.files);
+        for (auto ctr = std::uint64_t{0}; ctr < h.files; ++ctr) {
+            file_entry fe{};
+            take (&fe, sizeof (fe));
+            file f{fe.compilation, arch_position{fe.archive, fe.member}, fe.group, {}, {}, {}};
+            f.origin.resize (fe.origin_length);
+            take (f.origin.data (), f.origin.size ());
+            f.definitions.resize (fe.definitions);
+            take (f.definitions.data (), f.definitions.size () * sizeof (address));
+            f.references.resize (fe.references);
+            take (f.references.data (), f.references.size () * sizeof (address));
+            s.files.push_back (std::move (f));
+        }
+        return s;
+    }
+
+    void write (state const & s, std::string const & path) {
+        header h{};
+        std::memcpy (h.magic, header::magic_value, sizeof (h.magic));
+        h.version = header::current_version;
+        h.inputs = s.inputs;
+        h.undefined = s.undefined;
+        h.files = s.files.size ();
+
+        std::ofstream os{path, std::ios::binary | std::ios::trunc};
+        if (!os) {
+            throw std::runtime_error{path + ": could not open for writing"};
+        }
+        write_array (os, &h, 1U);
+        for (file const & f : s.files) {
+            file_entry const fe{f.compilation,
+                                f.position.archive (),
+                                f.position.member (),
+                                f.group,
+                                static_cast<std::uint32_t> (f.origin.size ()),
+                                f.definitions.size (),
+                                f.references.size ()};
+            write_array (os, &fe, 1U);
+            write_array (os, f.origin.data (), f.origin.size ());
+            write_array (os, f.definitions.data (), f.definitions.size ());
+            write_array (os, f.references.data (), f.references.size ());
+        }
+        if (!os) {
+            throw std::runtime_error{path + ": write failed"};
+        }
+    }
+
+} // end namespace link_state
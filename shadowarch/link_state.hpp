@@ -0,0 +1,119 @@
+#ifndef LINK_STATE_HPP
+#define LINK_STATE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "compilationref.hpp"
+#include "repo.hpp"
+
+struct context;
+
+namespace link_state {
+
+    // The link state file. All integers are stored in host byte order.
+    //
+    // +-------------------+
+    // | header            |
+    // +-------------------+
+    // | file[0]           | file_entry, origin chars, definitions address[], references address[]
+    // | ...               |
+    // | file[n-1]         |
+    // +-------------------+
+
+    struct header {
+        static constexpr char magic_value[8] = {'R', 'L', 'D', 'S', 'T', 'A', 'T', 'E'};
+        static constexpr std::uint32_t current_version = 1U;
+
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t padding;
+        std::uint64_t inputs;
+        std::uint64_t undefined;
+        std::uint64_t files;
+    };
+
+    struct file_entry {
+        digest compilation;
+        std::uint32_t archive;
+        std::uint32_t member;
+        std::uint32_t group;
+        std::uint32_t origin_length;
+        std::uint64_t definitions;
+        std::uint64_t references;
+    };
+
+    /// A file which was included in the link.
+    struct file {
+        digest compilation;
+        arch_position position;
+        /// The symbol resolution group in which the file was resolved.
+        unsigned group;
+        std::string origin;
+        /// The names defined by the file.
+        std::vector<address> definitions;
+        /// The names referenced by the file's fragments, sorted and without duplicates.
+        std::vector<address> references;
+    };
+
+    /// The outcome of a link, saved so that the next link of the same inputs need resolve only
+    /// the compilations which have changed.
+    struct state {
+        /// Identifies the link's archive members and tickets (see fingerprint()).
+        std::uint64_t inputs = 0U;
+        /// The number of symbols which were left undefined.
+        std::uint64_t undefined = 0U;
+        /// The files in the link indexed by ordinal.
+        std::vector<file> files;
+    };
+
+    /// Returns a value which identifies the archive members and the origins and positions of the
+    /// tickets. The contents of the tickets are not included: changes to them are handled
+    /// incrementally.
+    std::uint64_t fingerprint (std::vector<compilationref> const & tickets,
+                               std::vector<compilationref> const & members);
+
+    /// Describes the file \p cr which was resolved in group \p group.
+    file make_file (repository_view const & repo, compilationref const & cr, unsigned group);
+
+    /// Decides whether a link can reuse the state of the previous link.
+    ///
+    /// The previous state is reused if the archive members are unchanged, each changed ticket
+    /// defines the same names as before, and the changes to the tickets' references do not alter
+    /// the archive members which are pulled into the link or the groups in which they are
+    /// resolved. In that case, a full link would assign every file the same ordinal as before.
+    ///
+    /// \param previous  The state saved by the previous link.
+    /// \param inputs  The fingerprint of the link's inputs.
+    /// \param tickets  The compilations named on the command line.
+    /// \param repo  The repository being linked.
+    /// \param reason  Set to a description of the change that requires a full link.
+    /// \returns The ordinals of the tickets whose contents have changed (which may be none) or
+    ///   std::nullopt if the inputs must be linked in full.
+    std::optional<std::vector<unsigned>> changed_files (state const & previous,
+                                                        std::uint64_t inputs,
+                                                        std::vector<compilationref> const & tickets,
+                                                        repository_view const & repo,
+                                                        std::string & reason);
+
+    /// Restores the symbols of the previous link into shadow memory and the symbol table and
+    /// gives every file its previous ordinal. The names defined by the files in \p changed are
+    /// restored as undefined symbols: those files must be resolved again.
+    void restore (state const & previous, std::vector<unsigned> const & changed,
+                  std::vector<compilationref> const & tickets,
+                  std::vector<compilationref> const & members, context & context);
+
+    /// Reads a link state file.
+    /// \returns std::nullopt if the file does not exist.
+    /// \throws std::runtime_error if the file is not a valid link state file.
+    std::optional<state> read (std::string const & path);
+
+    /// Writes \p s to the file at \p path.
+    /// \throws std::runtime_error if the file could not be written.
+    void write (state const & s, std::string const & path);
+
+} // end namespace link_state
+
+#endif // LINK_STATE_HPP
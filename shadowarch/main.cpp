@@ -1,27 +1,57 @@
 #include <array>
 #include <chrono>
 #include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <tuple>
 
+#include "Trace.h"
+#include "Visited.h"
+#include "allocation_count.hpp"
+#include "archive_index.hpp"
+#include "archive_lookup.hpp"
 #include "context.hpp"
+#include "generator.hpp"
 #include "group.hpp"
+#include "group_sort.hpp"
+#include "layout.hpp"
+#include "link_state.hpp"
+#include "per_thread.hpp"
 #include "print.hpp"
+#include "repo_file.hpp"
+#include "resource_usage.hpp"
 #include "shadow.hpp"
+#include "shadow_batch.hpp"
+#include "shadow_sweep.hpp"
 #include "symbol.hpp"
+#include "task_pool.hpp"
+#include "timeline.hpp"
 
 using namespace std::string_literals;
 using namespace std::chrono_literals;
 
 namespace {
 
-    // Used to introduce artifical delays so that the timing can be perturbed.
-    constexpr auto shadow_sleep = .0s;
-    constexpr auto resolution_sleep = .2s;
-    constexpr auto archive_sleep = .1s;
+    // Used to introduce artifical delays so that the timing can be perturbed. The delays are
+    // removed by --no-delays and for generated links.
+    struct delays {
+        std::chrono::duration<double> shadow = .0s;
+        std::chrono::duration<double> resolution = .2s;
+        std::chrono::duration<double> archive = .1s;
+        std::chrono::duration<double> layout = .1s;
+    };
+    delays delay;
+
+    // If true, the shadow memory updates made for each compilation are sorted by address and
+    // prefetched rather than being made in repository order (--batch-shadow).
+    bool batch_updates = false;
 
     enum { f, g, h, j };
     constexpr std::array<digest, 4> compilation_digests = {
@@ -45,20 +75,17 @@ namespace {
             {strings[h].first, strings[h].second},
             {strings[j].first, strings[j].second},
         };
-        db.fragments = decltype (db.fragments){
-            {fragment_digests[f], fragment{strings[g].first, strings[h].first}}, // f -> g, h
-            {fragment_digests[g], fragment{strings[j].first}},                   // g -> j
-            {fragment_digests[h], fragment{}},                                   // h -> ∅
-            {fragment_digests[j], fragment{}},                                   // j -> ∅
-        };
-        db.compilations = decltype (db.compilations){
-            {compilation_digests[f], compilation{{strings[f].first, fragment_digests[f]}}},
-            {compilation_digests[g], compilation{{strings[g].first, fragment_digests[g]}}},
-            {compilation_digests[h], compilation{{strings[h].first, fragment_digests[h]}}},
-            {compilation_digests[j], compilation{{strings[j].first, fragment_digests[j]}}},
-        };
+        db.add (fragment_digests[f], fragment{strings[g].first, strings[h].first}); // f -> g, h
+        db.add (fragment_digests[g], fragment{strings[j].first});                   // g -> j
+        db.add (fragment_digests[h], fragment{});                                   // h -> ∅
+        db.add (fragment_digests[j], fragment{});                                   // j -> ∅
 
-        for (auto const & cp : db.compilations) {
+        db.add (compilation_digests[f], compilation{{strings[f].first, fragment_digests[f]}});
+        db.add (compilation_digests[g], compilation{{strings[g].first, fragment_digests[g]}});
+        db.add (compilation_digests[h], compilation{{strings[h].first, fragment_digests[h]}});
+        db.add (compilation_digests[j], compilation{{strings[j].first, fragment_digests[j]}});
+
+        for (auto const & cp : db.compilations ()) {
             compilation const & c = cp.second;
             for (auto const & definition : c.definitions) {
                 db.size = std::max (db.size, static_cast<std::size_t> ((definition.name + sizeof (address)).raw ()));
@@ -67,135 +94,247 @@ namespace {
         return db;
     }
 
-    ios_printer print{std::cout, true /*enabled*/};
+    link_inputs demo_inputs () {
+        link_inputs inputs{build_repository (), {}, {}};
 
+        // | Ticket  | Position  |
+        // | --------| --------- |
+        // | f.o     | (0,0)     |
+        //
+        // | Archive | File members | Position     |
+        // | ------- | ------------ | ------------ |
+        // | liba.a  | g.o j.o      | (1,0), (1,1) |
+        // | libb.a  | h.o          | (2,0)        |
+        // | libc.a  | g.o          | (3,0)        |
+        //
+        // These are provided (albeit indirectly) on the command-line.
+        inputs.tickets.emplace_back (compilation_digests[f], "f.o"s, arch_position{0, 0});
 
-    void symbol_resolution (context & context, compilationref * const compilationref,
-                            unsigned const ordinal, group_set * const next_group) {
-        auto const & compilations_index = context.repo.compilations;
-        auto const & fragments_index = context.repo.fragments;
-        print ("Symbol resolution for compilation ", compilationref->compilation, " (origin=\"",
-               compilationref->origin, "\", ordinal=", ordinal, ')');
-
-        compilation const & c = compilations_index.find (compilationref->compilation)->second;
-        for (auto const & definition : c.definitions) {
-            std::this_thread::sleep_for (resolution_sleep);
-
-            auto const create = [&] {
-                print ("  Create def: ", context.name (definition.name));
-                return shadow::tagged_pointer{new_symbol (context, definition.name, ordinal)};
-            };
-            auto const create_from_compilationref = [&] (std::atomic<void *> * /*p*/,
-                                                         struct compilationref * /*cr*/) {
-                print ("  Create def (overriding compilationref): ",
-                       context.name (definition.name));
-                context.undefs.erase (definition.name);
-                return shadow::tagged_pointer{create ()};
-            };
-            auto const update = [&] (std::atomic<void *> *, symbol * const sym) {
-                print ("  Undef to def: ", context.name (sym->name ()));
-                assert (!sym->is_def ());
-                context.undefs.erase (sym->name ());
-                sym->set_ordinal (ordinal);
-                return shadow::tagged_pointer{sym};
-            };
-            shadow::set (context.shadow_pointer (definition.name), create,
-                         create_from_compilationref, update);
-
-            fragment const & f = fragments_index.find (definition.fragment)->second;
-            for (address const ref : f.references) {
-                std::this_thread::sleep_for (resolution_sleep);
-                auto const create_undef = [&] {
-                    print ("  Create undef: ", context.name (ref));
-                    // new symbol adds to the collection of undefs.
-                    return shadow::tagged_pointer{new_symbol (context, ref)};
-                };
-                // FIXME: name of this lambda.
-                // Note that this function does not create an undef symbol, despite what its name
-                // suggests. We need to keep the compilationref record in the shadow memory in order
-                // that the we can get the correct compilation when it comes time to turn
-                // 'next_group' into the set of compilations for the next iteration. Bear in mind
-                // that a specific compilationref record can be replaced if we later find a
-                // definition in a library member with an earlier position than the one we have
-                // here.
-                auto const create_undef_from_compilationref =
-                    [&] (std::atomic<void *> * const p, struct compilationref * const cr) {
-                        print ("  compilationref -> undef ", cr->position, ": ",
-                               context.name (ref));
-                        next_group->insert (p);
-                        context.undefs.add (ref);
-                        return shadow::tagged_pointer{cr};
-                    };
-                auto const update2 = [&] (std::atomic<void *> *, symbol * const sym) {
-                    // We already have a symbol* associated with this name. Nothing to do.
-                    return shadow::tagged_pointer{sym};
-                };
-                shadow::set (context.shadow_pointer (ref), create_undef,
-                             create_undef_from_compilationref, update2);
+        // Position x=0 is assigned to the ticket files on the command line.
+        constexpr auto liba = 1U;
+        constexpr auto libb = 2U;
+        constexpr auto libc = 3U;
+        assert ((arch_position{0, 1} < arch_position{1, 0}));
+
+        inputs.members.emplace_back (compilation_digests[g], "liba.a(g.o)"s,
+                                     arch_position{liba, 0U});
+        inputs.members.emplace_back (compilation_digests[j], "liba.a(j.o)"s,
+                                     arch_position{liba, 1U});
+        inputs.members.emplace_back (compilation_digests[h], "libb.a(h.o)"s,
+                                     arch_position{libb, 0U});
+        inputs.members.emplace_back (compilation_digests[g], "libc.a(g.o)"s,
+                                     arch_position{libc, 0U});
+        return inputs;
+    }
+
+    /// The state of lazy archive discovery. Discovery records each archive definition in the
+    /// lookup table; symbol resolution consults the table when it creates an undef.
+    struct lazy_archives {
+        explicit lazy_archives (repository_view const & repo, std::vector<compilationref> & m)
+                : members{m}
+                , lookup{count_definitions (repo, m)} {}
+
+        static std::size_t count_definitions (repository_view const & repo,
+                                              std::vector<compilationref> const & members) {
+            auto result = std::size_t{0};
+            for (compilationref const & cr : members) {
+                result += repo.definitions (cr.compilation).size ();
             }
+            return result;
         }
+
+        /// The archive members in archive order. Shadow memory points at these compilationrefs.
+        std::vector<compilationref> & members;
+        archive_lookup lookup;
+    };
+
+    /// Records the definition of \p name by the file with ordinal \p ordinal.
+    void resolve_definition (context & context, address const name, unsigned const ordinal) {
+        auto const create = [&] {
+            RLD_TRACE ("  Create def: ", context.name (name));
+            return shadow::tagged_pointer{new_symbol (context, name, ordinal)};
+        };
+        auto const create_from_compilationref = [&] (std::atomic<void *> * /*p*/,
+                                                     compilationref * /*cr*/) {
+            RLD_TRACE ("  Create def (overriding compilationref): ", context.name (name));
+            context.undefs.erase (name);
+            return shadow::tagged_pointer{create ()};
+        };
+        auto const update = [&] (std::atomic<void *> *, symbol_handle const sym) {
+            RLD_TRACE ("  Undef to def: ", context.name (context.symbols.name (sym)));
+            assert (!context.symbols.is_def (sym));
+            context.undefs.erase (context.symbols.name (sym));
+            context.symbols.set_ordinal (sym, ordinal);
+            return shadow::tagged_pointer{sym};
+        };
+        shadow::set (context.shadow_pointer (name), create, create_from_compilationref, update);
     }
 
-    void archive_discovery (context & context, compilationref const & lm,
-                            group_set * const next_group) {
-        auto const index = lm.position;
-        print ("Archive Discovery for ", lm.origin, ", position ", index, ", compilation ",
-               lm.compilation);
-
-        auto const & compilations_index = context.repo.compilations;
-        auto const & names_index = context.repo.names;
-
-        compilation const & c = compilations_index.find (lm.compilation)->second;
-        for (auto const & definition : c.definitions) {
-            std::this_thread::sleep_for (archive_sleep);
-            print ("  compilationref: ", names_index.find (definition.name)->second);
-
-            auto create = [&] {
-                print ("    Create compilationref: ", names_index.find (definition.name)->second);
-                std::lock_guard<std::mutex> _{context.compilationrefs_mutex};
-                context.compilationrefs.emplace_back (lm.compilation, lm.origin, lm.position);
-                return shadow::tagged_pointer{&context.compilationrefs.back ()};
-            };
-            auto const create_from_compilationref = [&] (std::atomic<void *> *,
-                                                         compilationref * const cr) {
-                // There's an existing compilationref for this symbol. Check the associated ordinal
-                // and keep the one with the lower position.
-                if (index < cr->position) {
-                    print ("    Replace compilationref for \"",
-                           names_index.find (definition.name)->second, "\": ", cr->position,
-                           " with ", index);
-                    return shadow::tagged_pointer{create ()};
+    /// Records a reference to \p ref.
+    void resolve_reference (context & context, address const ref, group_set * const next_group,
+                            lazy_archives const * const lazy) {
+        auto const create_undef = [&] {
+            if (lazy != nullptr) {
+                auto const member = lazy->lookup.find (ref);
+                if (member != archive_lookup::npos) {
+                    // An archive member defines this name: record the member for the next group
+                    // exactly as if discovery had already pointed the name at it.
+                    compilationref & lm = lazy->members[member];
+                    RLD_TRACE ("  Create compilationref (lazy) ", lm.position, ": ",
+                               context.name (ref));
+                    next_group->insert (context.shadow_pointer (ref));
+                    context.undefs.add (ref);
+                    return shadow::tagged_pointer{&lm};
                 }
-                print ("    Rejected: ", names_index.find (definition.name)->second,
-                       " in favor of ", cr->position);
-                return shadow::tagged_pointer{cr};
-            };
+            }
+            RLD_TRACE ("  Create undef: ", context.name (ref));
+            // new symbol adds to the collection of undefs.
+            return shadow::tagged_pointer{new_symbol (context, ref)};
+        };
+        // FIXME: name of this lambda.
+        // Note that this function does not create an undef symbol, despite what its name
+        // suggests. We need to keep the compilationref record in the shadow memory in order
+        // that the we can get the correct compilation when it comes time to turn
+        // 'next_group' into the set of compilations for the next iteration. Bear in mind
+        // that a specific compilationref record can be replaced if we later find a
+        // definition in a library member with an earlier position than the one we have
+        // here.
+        auto const create_undef_from_compilationref = [&] (std::atomic<void *> * const p,
+                                                           compilationref * const cr) {
+            RLD_TRACE ("  compilationref -> undef ", cr->position, ": ", context.name (ref));
+            next_group->insert (p);
+            context.undefs.add (ref);
+            return shadow::tagged_pointer{cr};
+        };
+        auto const update2 = [&] (std::atomic<void *> *, symbol_handle const sym) {
+            // We already have a symbol associated with this name. Nothing to do.
+            return shadow::tagged_pointer{sym};
+        };
+        shadow::set (context.shadow_pointer (ref), create_undef, create_undef_from_compilationref,
+                     update2);
+    }
 
-            auto const update = [&] (std::atomic<void *> * const p, symbol * const sym) {
-                auto const lock = sym->take_lock ();
-                if (sym->is_def (lock)) {
-                    return shadow::tagged_pointer{sym};
+    /// \param lazy  If not null, the lookup table is complete and a reference to a name which is
+    ///   defined by an archive member yields a compilationref for that member rather than an undef.
+    void symbol_resolution (context & context, compilationref * const compilationref,
+                            unsigned const ordinal, group_set * const next_group,
+                            Visited * const visited, lazy_archives const * const lazy) {
+        timeline::scope const _{"symbol resolution", "ordinal", ordinal};
+        repository_view const & repo = *context.repo;
+        RLD_TRACE ("Symbol resolution for compilation ", compilationref->compilation, " (origin=\"",
+                   compilationref->origin (), "\", ordinal=", ordinal, ')');
+
+        if (batch_updates) {
+            // Each name is tagged with whether it is referenced. A definition is therefore
+            // resolved before any reference to the same name from this compilation.
+            thread_local shadow::batch batch;
+            batch.clear ();
+            for (auto const & definition : repo.definitions (compilationref->compilation)) {
+                batch.add (definition.name, false);
+                for (address const ref : repo.references (definition.fragment)) {
+                    batch.add (ref, true);
                 }
-                // A definition in an archive has matched with an undefined symbol. Turn the
-                // undef into an compilationref.
-                assert (context.undefs.has (sym->name ()));
-                next_group->insert (p);
-                return create ();
-            };
-            shadow::set (context.shadow_pointer (definition.name), create,
-                         create_from_compilationref, update);
+            }
+            batch.apply ([&context] (address const name) { return context.shadow_pointer (name); },
+                         [&] (address const name, bool const is_reference) {
+                             std::this_thread::sleep_for (delay.resolution);
+                             if (is_reference) {
+                                 resolve_reference (context, name, next_group, lazy);
+                             } else {
+                                 resolve_definition (context, name, ordinal);
+                             }
+                         });
+        } else {
+            for (auto const & definition : repo.definitions (compilationref->compilation)) {
+                std::this_thread::sleep_for (delay.resolution);
+                resolve_definition (context, definition.name, ordinal);
+                for (address const ref : repo.references (definition.fragment)) {
+                    std::this_thread::sleep_for (delay.resolution);
+                    resolve_reference (context, ref, next_group, lazy);
+                }
+            }
         }
+        // This file is now ready for layout.
+        visited->fileCompleted (ordinal);
     }
 
-    template <typename Iterator>
-    void join_all (Iterator first, Iterator last) {
-        std::for_each (first, last, [] (std::thread & t) {
-            if (t.joinable ()) {
-                t.join ();
+    /// Records that the archive member \p lm defines \p name. The shadow pointer for \p name
+    /// points at \p lm itself: each member has a single compilationref however many names it
+    /// defines.
+    void discover_definition (context & context, compilationref & lm, address const name,
+                              group_set * const next_group) {
+        auto const index = lm.position;
+        RLD_TRACE ("  compilationref: ", context.name (name));
+
+        auto create = [&] {
+            RLD_TRACE ("    Create compilationref: ", context.name (name));
+            return shadow::tagged_pointer{&lm};
+        };
+        auto const create_from_compilationref = [&] (std::atomic<void *> *,
+                                                     compilationref * const cr) {
+            // Another member already defines this symbol. Keep the one with the lower position.
+            // Both compilationrefs belong to the link inputs so replacing one leaks nothing.
+            if (index < cr->position) {
+                RLD_TRACE ("    Replace compilationref for \"", context.name (name), "\": ",
+                           cr->position, " with ", index);
+                return shadow::tagged_pointer{create ()};
             }
-        });
+            RLD_TRACE ("    Rejected: ", context.name (name), " in favor of ", cr->position);
+            return shadow::tagged_pointer{cr};
+        };
+
+        auto const update = [&] (std::atomic<void *> * const p, symbol_handle const sym) {
+            if (context.symbols.is_def (sym)) {
+                return shadow::tagged_pointer{sym};
+            }
+            // A definition in an archive has matched with an undefined symbol. Turn the
+            // undef into an compilationref.
+            assert (context.undefs.has (context.symbols.name (sym)));
+            next_group->insert (p);
+            return create ();
+        };
+        shadow::set (context.shadow_pointer (name), create, create_from_compilationref, update);
+    }
+
+    void archive_discovery (context & context, compilationref & lm,
+                            group_set * const next_group) {
+        timeline::scope const _{"archive discovery", "member", lm.position.member ()};
+        RLD_TRACE ("Archive Discovery for ", lm.origin (), ", position ", lm.position,
+                   ", compilation ", lm.compilation);
+
+        repository_view const & repo = *context.repo;
+        if (batch_updates) {
+            thread_local shadow::batch batch;
+            batch.clear ();
+            for (auto const & definition : repo.definitions (lm.compilation)) {
+                batch.add (definition.name, false);
+            }
+            batch.apply ([&context] (address const name) { return context.shadow_pointer (name); },
+                         [&] (address const name, bool) {
+                             std::this_thread::sleep_for (delay.archive);
+                             discover_definition (context, lm, name, next_group);
+                         });
+            return;
+        }
+        for (auto const & definition : repo.definitions (lm.compilation)) {
+            std::this_thread::sleep_for (delay.archive);
+            discover_definition (context, lm, definition.name, next_group);
+        }
     }
 
+    /// Archive discovery driven by an archive's index rather than by its members' definitions.
+    /// \param members  The archive's members in archive order.
+    /// \param entries  A range of the entries from the archive's index.
+    void indexed_archive_discovery (context & context,
+                                    std::vector<compilationref *> const & members,
+                                    span<archive_index::entry const> const & entries,
+                                    group_set * const next_group) {
+        timeline::scope const _{"indexed archive discovery", "entries", entries.size ()};
+        for (archive_index::entry const & e : entries) {
+            std::this_thread::sleep_for (delay.archive);
+            discover_definition (context, *members[e.member], e.name, next_group);
+        }
+    }
 
     template <typename T>
     struct reverse_wrapper {
@@ -215,119 +354,886 @@ namespace {
     }
 
 
-    std::vector<std::thread> create_arch_threads (context & context,
-                                                  std::vector<compilationref> const & archives,
-                                                  group_set * const next_group) {
-        std::vector<std::thread> arch_threads;
-        arch_threads.reserve (archives.size ());
-        for (auto const & arch : reverse (archives)) {
-            arch_threads.emplace_back (archive_discovery, std::ref (context),
-                                                  std::cref (arch), next_group);
+    /// Records the time spent by the archive discovery tasks, the time at which the last of them
+    /// finished, and the number of heap allocations that they made. Discovery may be cancelled
+    /// once there are no undefined symbols left for it to satisfy: tasks which have not yet
+    /// started then do nothing.
+    class discovery_status {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /// The state of the thread when a task started.
+        struct task_start {
+            clock::time_point time;
+            std::uint64_t allocations;
+        };
+
+        discovery_status () noexcept
+                : start_{clock::now ()} {}
+
+        /// Called by a discovery task as it starts.
+        static task_start started () noexcept {
+            return {clock::now (), thread_allocation_count ()};
+        }
+        /// Records the completion of a task which started at \p start.
+        void finished (task_start const & start) noexcept {
+            auto const now = clock::now ();
+            busy_.fetch_add ((now - start.time).count (), std::memory_order_relaxed);
+            allocations_.fetch_add (thread_allocation_count () - start.allocations,
+                                    std::memory_order_relaxed);
+            auto const end = (now - start_).count ();
+            auto last = last_.load (std::memory_order_relaxed);
+            while (end > last &&
+                   !last_.compare_exchange_weak (last, end, std::memory_order_relaxed)) {
+            }
+        }
+        /// The time from the start of discovery until the last task finished.
+        std::chrono::duration<double, std::milli> elapsed () const noexcept {
+            return clock::duration{last_.load (std::memory_order_relaxed)};
+        }
+        /// The total time spent running discovery tasks.
+        std::chrono::duration<double, std::milli> busy () const noexcept {
+            return clock::duration{busy_.load (std::memory_order_relaxed)};
+        }
+        /// The number of heap allocations made by discovery tasks.
+        std::uint64_t allocations () const noexcept {
+            return allocations_.load (std::memory_order_relaxed);
+        }
+
+        void cancel () noexcept { cancelled_.store (true, std::memory_order_relaxed); }
+        bool cancelled () const noexcept { return cancelled_.load (std::memory_order_relaxed); }
+
+    private:
+        clock::time_point const start_;
+        std::atomic<clock::rep> last_{0};
+        std::atomic<clock::rep> busy_{0};
+        std::atomic<std::uint64_t> allocations_{0};
+        std::atomic<bool> cancelled_{false};
+    };
+
+    void submit_archive_discovery (task_pool & pool, task_group & archive_tasks,
+                                   context & context, std::vector<compilationref> & archives,
+                                   group_set * const next_group, discovery_status * const status) {
+        for (auto & arch : reverse (archives)) {
+            pool.submit (archive_tasks, [&context, &arch, next_group, status] {
+                if (status->cancelled ()) {
+                    return;
+                }
+                auto const start = discovery_status::started ();
+                archive_discovery (context, arch, next_group);
+                status->finished (start);
+            });
+        }
+    }
+
+    /// Submits a task for each archive which loads (or builds) the archive's index and then
+    /// submits tasks to merge the index's entries into shadow memory.
+    void submit_indexed_archive_discovery (
+        task_pool & pool, task_group & archive_tasks, context & context,
+        std::string const & directory,
+        std::vector<std::vector<compilationref *>> const & archives,
+        std::vector<std::unique_ptr<archive_index>> & indices, group_set * const next_group,
+        discovery_status * const status) {
+        for (auto a = std::size_t{0}; a < archives.size (); ++a) {
+            pool.submit (archive_tasks, [&pool, &archive_tasks, &context, &directory, &archives,
+                                         &indices, next_group, status, a] {
+                // The number of index entries merged by each task.
+                constexpr auto chunk_size = std::size_t{4096};
+                if (status->cancelled ()) {
+                    return;
+                }
+                auto const start = discovery_status::started ();
+                std::vector<compilationref *> const & members = archives[a];
+                indices[a] = std::make_unique<archive_index> (directory, *context.repo, members);
+                span<archive_index::entry const> const entries = indices[a]->entries ();
+                for (auto first = std::size_t{0}; first < entries.size (); first += chunk_size) {
+                    span<archive_index::entry const> const chunk{
+                        entries.begin () + first, std::min (chunk_size, entries.size () - first)};
+                    pool.submit (archive_tasks, [&context, &members, chunk, next_group, status] {
+                        if (status->cancelled ()) {
+                            return;
+                        }
+                        auto const chunk_start = discovery_status::started ();
+                        indexed_archive_discovery (context, members, chunk, next_group);
+                        status->finished (chunk_start);
+                    });
+                }
+                status->finished (start);
+            });
+        }
+    }
+
+    /// Submits a task for each archive member which adds the member's definitions to the lazy
+    /// lookup table. Shadow memory is not touched.
+    void submit_lazy_archive_discovery (task_pool & pool, task_group & archive_tasks,
+                                        context & context, lazy_archives * const lazy,
+                                        discovery_status * const status) {
+        auto const size = static_cast<std::uint32_t> (lazy->members.size ());
+        for (auto member = std::uint32_t{0}; member < size; ++member) {
+            pool.submit (archive_tasks, [&context, lazy, status, member] {
+                if (status->cancelled ()) {
+                    return;
+                }
+                auto const start = discovery_status::started ();
+                compilationref const & lm = lazy->members[member];
+                timeline::scope const _{"lazy archive discovery", "member", lm.position.member ()};
+                for (auto const & definition : context.repo->definitions (lm.compilation)) {
+                    std::this_thread::sleep_for (delay.archive);
+                    lazy->lookup.add (definition.name, member);
+                }
+                status->finished (start);
+            });
         }
-        return arch_threads;
+    }
+
+    /// Once the lazy lookup table is complete, gives each of the names left undefined by group 0
+    /// the compilationref of the first archive member which defines it.
+    void lazy_archive_catch_up (context & context, lazy_archives const & lazy,
+                                group_set * const next_group) {
+        timeline::scope const _{"lazy archive catch-up"};
+        // Collect the names first: discover_definition() consults the undefs.
+        std::vector<address> names;
+        names.reserve (context.undefs.size ());
+        context.undefs.for_each ([&names] (address const name) { names.push_back (name); });
+        for (address const name : names) {
+            auto const member = lazy.lookup.find (name);
+            if (member != archive_lookup::npos) {
+                discover_definition (context, lazy.members[member], name, next_group);
+            }
+        }
+    }
+
+    /// Returns the archive members grouped by archive. Each group is in archive order.
+    std::vector<std::vector<compilationref *>>
+    group_by_archive (std::vector<compilationref> & members) {
+        std::vector<std::vector<compilationref *>> result;
+        for (compilationref & cr : members) {
+            if (result.empty () ||
+                result.back ().front ()->position.archive () != cr.position.archive ()) {
+                result.emplace_back ();
+            }
+            result.back ().push_back (&cr);
+        }
+        return result;
+    }
+
+    void show_discovery (discovery_status const & status, std::size_t const members,
+                         std::vector<std::unique_ptr<archive_index>> const & indices,
+                         std::optional<lazy_archives> const & lazy) {
+        if (status.cancelled ()) {
+            // Tasks which had not started did nothing, so only some of the members were seen.
+            print ("Archive discovery cancelled (no undefined symbols remain): ",
+                   status.busy ().count (), "ms in tasks, complete at ",
+                   status.elapsed ().count (), "ms, ", status.allocations (), " heap allocations");
+        } else {
+            print ("Archive discovery: ", members, " members, ", status.busy ().count (),
+                   "ms in tasks, complete at ", status.elapsed ().count (), "ms, ",
+                   status.allocations (), " heap allocations");
+        }
+        if (lazy) {
+            print ("  Lazy lookup: ", lazy->lookup.size (), " names in ",
+                   lazy->lookup.bytes_allocated (), " bytes");
+        } else if (!indices.empty ()) {
+            // The index of an archive whose task was cancelled before it started is null.
+            auto loaded = std::size_t{0};
+            auto warm = std::size_t{0};
+            auto entries = std::size_t{0};
+            for (auto const & index : indices) {
+                if (index != nullptr) {
+                    ++loaded;
+                    warm += index->warm ();
+                    entries += index->entries ().size ();
+                }
+            }
+            print ("  Indices: ", loaded, " of ", indices.size (), " loaded (", warm, " warm, ",
+                   entries, " entries)");
+        }
+    }
+
+    struct options {
+        shadow_memory::backend shadow = shadow_memory::default_backend ();
+        std::size_t shadow_size = 0U;
+        /// The number of most-contended shadow pointers to report or 0 to disable.
+        unsigned contention_report = 0U;
+        /// If true, layout runs concurrently with symbol resolution. If false, layout starts
+        /// once resolution is complete.
+        bool pipeline = true;
+        /// If not empty, the repository is loaded from this file rather than built in memory.
+        std::string repo_path;
+        /// If not empty, the repository is written to this file and the program exits.
+        std::string write_repo_path;
+        /// The number of task pool workers or 0 to use the default.
+        unsigned threads = 0U;
+        /// If true, the link inputs are generated rather than using the built-in demo.
+        bool generate = false;
+        generator_params generator;
+        /// If true, the detailed log of each step of the link is suppressed.
+        bool quiet = false;
+        /// If true, the artificial delays are used.
+        bool delays = true;
+        /// If not empty, the completion time of each file is written to this file in the format
+        /// read by rld-visited --replay.
+        std::string visited_trace_path;
+        /// If not empty, a timeline of the link is written to this file in the Chrome trace event
+        /// format.
+        std::string chrome_trace_path;
+        /// If not empty, the state of the previous link is read from this file and the state of
+        /// this link written to it.
+        std::string state_path;
+        /// If not empty, archive discovery uses the archive indices cached in this directory.
+        std::string archive_index_path;
+        /// If true, archive definitions are recorded in a lookup table and shadow memory is
+        /// updated only for the names which are referenced while undefined.
+        bool lazy_archives = false;
+        /// If true, each compilation's shadow memory updates are made in address order.
+        bool batch_shadow = false;
+        /// If present, shadow memory is swept with this instruction set once the link is complete
+        /// and checked against the symbol table.
+        std::optional<shadow::sweep_isa> audit;
+        /// If not 0, the link is run this many times to check that every run assigns the same
+        /// ordinals.
+        unsigned verify_determinism = 0U;
     };
 
+    bool starts_with (std::string const & s, std::string const & prefix) {
+        return s.compare (0, prefix.length (), prefix) == 0;
+    }
+
+    std::optional<options> parse_options (int const argc, char const * const * const argv) {
+        options opts;
+        std::optional<bool> quiet;
+        std::optional<bool> delays;
+        for (auto arg = 1; arg < argc; ++arg) {
+            std::string const a = argv[arg];
+            if (starts_with (a, "--shadow=")) {
+                auto const kind = shadow_memory::parse_backend (a.substr (9));
+                if (!kind) {
+                    return std::nullopt;
+                }
+                opts.shadow = *kind;
+            } else if (starts_with (a, "--shadow-size=")) {
+                opts.shadow_size = std::stoull (a.substr (14));
+            } else if (starts_with (a, "--busy-spins=")) {
+                shadow::current_wait_policy ().spins =
+                    static_cast<unsigned> (std::stoul (a.substr (13)));
+            } else if (starts_with (a, "--busy-backoff=")) {
+                shadow::current_wait_policy ().backoff_rounds =
+                    static_cast<unsigned> (std::stoul (a.substr (15)));
+            } else if (starts_with (a, "--repo=")) {
+                opts.repo_path = a.substr (7);
+            } else if (starts_with (a, "--write-repo=")) {
+                opts.write_repo_path = a.substr (13);
+            } else if (a == "--no-pipeline") {
+                opts.pipeline = false;
+            } else if (a == "--contention") {
+                opts.contention_report = 10U;
+            } else if (starts_with (a, "--contention=")) {
+                opts.contention_report = static_cast<unsigned> (std::stoul (a.substr (13)));
+            } else if (starts_with (a, "--threads=")) {
+                opts.threads = static_cast<unsigned> (std::stoul (a.substr (10)));
+            } else if (a == "--quiet") {
+                quiet = true;
+            } else if (a == "--verbose") {
+                quiet = false;
+            } else if (starts_with (a, "--visited-trace=")) {
+                opts.visited_trace_path = a.substr (16);
+            } else if (starts_with (a, "--archive-index=")) {
+                opts.archive_index_path = a.substr (16);
+            } else if (starts_with (a, "--verify-determinism=")) {
+                opts.verify_determinism = static_cast<unsigned> (std::stoul (a.substr (21)));
+            } else if (a == "--audit") {
+                opts.audit = shadow::best_sweep_isa ();
+            } else if (starts_with (a, "--audit=")) {
+                opts.audit = shadow::parse_sweep_isa (a.substr (8));
+                if (!opts.audit) {
+                    return std::nullopt;
+                }
+            } else if (a == "--batch-shadow") {
+                opts.batch_shadow = true;
+            } else if (a == "--lazy-archives") {
+                opts.lazy_archives = true;
+            } else if (starts_with (a, "--state=")) {
+                opts.state_path = a.substr (8);
+            } else if (starts_with (a, "--chrome-trace=")) {
+                opts.chrome_trace_path = a.substr (15);
+            } else if (a == "--no-delays") {
+                delays = false;
+            } else if (a == "--generate") {
+                opts.generate = true;
+            } else if (starts_with (a, "--seed=")) {
+                opts.generate = true;
+                opts.generator.seed = std::stoull (a.substr (7));
+            } else if (starts_with (a, "--symbols=")) {
+                opts.generate = true;
+                opts.generator.symbols = std::stoull (a.substr (10));
+            } else if (starts_with (a, "--defs=")) {
+                opts.generate = true;
+                opts.generator.definitions_per_compilation =
+                    static_cast<unsigned> (std::stoul (a.substr (7)));
+            } else if (starts_with (a, "--fan-out=")) {
+                opts.generate = true;
+                opts.generator.fan_out = std::stod (a.substr (10));
+            } else if (starts_with (a, "--fan-out-dist=")) {
+                auto const d = generator_params::parse_distribution (a.substr (15));
+                if (!d) {
+                    return std::nullopt;
+                }
+                opts.generate = true;
+                opts.generator.fan_out_distribution = *d;
+            } else if (starts_with (a, "--duplicates=")) {
+                opts.generate = true;
+                opts.generator.duplicate_rate = std::stod (a.substr (13));
+            } else if (starts_with (a, "--depth=")) {
+                opts.generate = true;
+                opts.generator.depth = static_cast<unsigned> (std::stoul (a.substr (8)));
+            } else if (starts_with (a, "--archives=")) {
+                opts.generate = true;
+                opts.generator.archives = static_cast<unsigned> (std::stoul (a.substr (11)));
+            } else if (starts_with (a, "--edit=")) {
+                opts.generate = true;
+                opts.generator.edits = static_cast<unsigned> (std::stoul (a.substr (7)));
+            } else {
+                return std::nullopt;
+            }
+        }
+        if (opts.generate) {
+            generator_params const & g = opts.generator;
+            if (g.depth == 0U || g.symbols < g.depth || g.definitions_per_compilation == 0U ||
+                (g.depth > 1U && g.archives == 0U) || g.fan_out < 0.0 ||
+                g.duplicate_rate < 0.0 || g.duplicate_rate > 1.0) {
+                return std::nullopt;
+            }
+        }
+        if (opts.lazy_archives && !opts.archive_index_path.empty ()) {
+            return std::nullopt;
+        }
+        // Each run would relink from the state written by the one before.
+        if (opts.verify_determinism > 0U && !opts.state_path.empty ()) {
+            return std::nullopt;
+        }
+        // Generated links are typically large: by default they run without the detailed log and
+        // without the artificial delays.
+        opts.quiet = quiet.value_or (opts.generate);
+        opts.delays = delays.value_or (!opts.generate);
+        return opts;
+    }
+
+    void usage (char const * const argv0) {
+        std::cerr << "Usage: " << argv0 << " [options]\n"
+                  << "  --shadow=vector|mmap|huge  The shadow memory allocator\n"
+                  << "  --shadow-size=<bytes>      Minimum size of shadow memory\n"
+                  << "  --busy-spins=<n>           Pause spins before backing off\n"
+                  << "  --busy-backoff=<n>         Exponential backoff rounds before parking\n"
+                  << "  --contention[=<n>]         Report the n most contended shadow pointers\n"
+                  << "  --no-pipeline              Lay out only after resolution has finished\n"
+                  << "  --repo=<file>              Map the repository from a file\n"
+                  << "  --write-repo=<file>        Write the repository to a file and exit\n"
+                  << "  --threads=<n>              The number of task pool workers\n"
+                  << "  --quiet, --verbose         Disable or enable the detailed log\n"
+                  << "  --no-delays                Remove the artificial delays\n"
+                  << "  --visited-trace=<file>     Write file completion times for replay\n"
+                  << "  --archive-index=<dir>      Cache an index of each archive in a directory\n"
+                  << "  --audit[=scalar|sse2|avx2] Sweep shadow memory and check its consistency\n"
+                  << "  --batch-shadow             Update shadow memory in address order\n"
+                  << "  --lazy-archives            Discover only referenced archive definitions\n"
+                  << "                             (cannot be used with --archive-index)\n"
+                  << "  --state=<file>             Reuse and save the link state for relinking\n"
+                  << "  --chrome-trace=<file>      Write a Chrome trace timeline of the link\n"
+                  << "  --verify-determinism=<n>   Link n times and check that the ordinals match\n"
+                  << "\nGenerated links (any of these options generates the link inputs):\n"
+                  << "  --generate                 Generate with the default parameters\n"
+                  << "  --seed=<n>                 The random number generator seed\n"
+                  << "  --symbols=<n>              The number of symbols defined\n"
+                  << "  --defs=<n>                 The number of definitions per compilation\n"
+                  << "  --fan-out=<mean>           The mean number of references per fragment\n"
+                  << "  --fan-out-dist=fixed|uniform|geometric\n"
+                  << "                             The distribution of references per fragment\n"
+                  << "  --duplicates=<p>           The probability that a member is duplicated\n"
+                  << "  --depth=<n>                The number of symbol resolution groups\n"
+                  << "  --archives=<n>             The number of archives\n"
+                  << "  --edit=<n>                 Edit the bodies of the first n tickets\n"
+                  << "With --repo, the archive layout is generated and the repository is mapped.\n";
+    }
+
+    /// Sweeps shadow memory once the link is complete and checks that it agrees with the symbol
+    /// table and the collection of undefined symbols.
+    /// \returns True if shadow memory is consistent.
+    bool audit_shadow (context & context, task_pool & pool, shadow::sweep_isa const isa) {
+        timeline::scope const _{"shadow audit"};
+        auto const start = std::chrono::steady_clock::now ();
+        shadow::sweep_result const swept = shadow::sweep (context.shadow, pool, isa);
+        std::chrono::duration<double> const sweep_time = std::chrono::steady_clock::now () - start;
+
+        auto defined = std::size_t{0};
+        auto misnamed = std::size_t{0};
+        std::vector<address> undefined;
+        for (address const name : swept.symbols) {
+            symbol_handle const sym =
+                shadow::as_symbol (context.shadow_pointer (name)->load (std::memory_order_relaxed));
+            if (context.symbols.name (sym) != name) {
+                ++misnamed;
+            }
+            if (context.symbols.is_def (sym)) {
+                ++defined;
+            } else {
+                undefined.push_back (name);
+            }
+        }
+        print ("Shadow audit (", shadow::to_string (isa), "): ", swept.symbols.size (),
+               " symbols (", defined, " defined), ", swept.compilationrefs.size (),
+               " compilationrefs, ", swept.busy.size (), " busy, ", swept.nulls, " null in ",
+               sweep_time.count () * 1e3, "ms (",
+               static_cast<double> (context.shadow.size ()) / sweep_time.count () / 1e9, " GB/s)");
+
+        bool const consistent =
+            swept.busy.empty () && misnamed == 0U && undefined.size () == context.undefs.size () &&
+            std::all_of (std::begin (undefined), std::end (undefined),
+                         [&context] (address const name) { return context.undefs.has (name); });
+        if (!consistent) {
+            print ("Shadow audit failed: ", undefined.size (),
+                   " undefined symbols in shadow memory (", context.undefs.size (),
+                   " expected), ", misnamed, " misnamed, ", swept.busy.size (), " busy");
+        }
+        return consistent;
+    }
+
+    void show_contention (context const & context, unsigned const limit) {
+        auto counts = shadow::contention_stats::get ().snapshot ();
+        auto const last = std::begin (counts) + std::min (counts.size (), std::size_t{limit});
+        std::partial_sort (std::begin (counts), last, std::end (counts),
+                           [] (auto const & a, auto const & b) {
+                               return a.second.spin_iterations > b.second.spin_iterations;
+                           });
+        print ("Contended shadow pointers: ", counts.size ());
+        std::for_each (std::begin (counts), last, [&context] (auto const & c) {
+            print ("  ", context.name (context.shadow_address (c.first)),
+                   ": busy=", c.second.busy_encounters, " spins=", c.second.spin_iterations,
+                   " parks=", c.second.parks);
+        });
+    }
+
+    std::string as_string (std::optional<std::size_t> const bytes) {
+        return bytes ? std::to_string (*bytes) + " bytes" : "unavailable"s;
+    }
+
+
+    void write_visited_trace (std::string const & path,
+                              per_thread<std::vector<TraceRecord>> & completions) {
+        std::vector<TraceRecord> records;
+        completions.for_each ([&records] (std::thread::id, std::vector<TraceRecord> const & v) {
+            records.insert (std::end (records), std::begin (v), std::end (v));
+        });
+        std::sort (std::begin (records), std::end (records),
+                   [] (TraceRecord const & a, TraceRecord const & b) {
+                       return a.Ordinal < b.Ordinal;
+                   });
+        std::ofstream os{path};
+        writeTrace (os, records);
+        if (!os) {
+            throw std::runtime_error{path + ": could not write the trace"};
+        }
+    }
+
+    /// Saves the state of the link. After an incremental link, the previous state is updated
+    /// with the files which changed; otherwise, the state is gathered from the repository.
+    void write_link_state (std::string const & path, context const & context,
+                           link_inputs const & inputs, std::uint64_t const fingerprint,
+                           std::optional<link_state::state> && previous,
+                           std::optional<std::vector<unsigned>> const & changed,
+                           std::vector<unsigned> const & groups, unsigned const files) {
+        auto const start = std::chrono::steady_clock::now ();
+        link_state::state next;
+        if (changed) {
+            next = std::move (*previous);
+            for (unsigned const ordinal : *changed) {
+                next.files[ordinal] =
+                    link_state::make_file (*context.repo, inputs.tickets[ordinal], 0U);
+            }
+        } else {
+            next.files.reserve (files);
+            for (auto ordinal = 0U; ordinal < files; ++ordinal) {
+                next.files.push_back (link_state::make_file (
+                    *context.repo, *context.files_by_ordinal[ordinal], groups[ordinal]));
+            }
+        }
+        next.inputs = fingerprint;
+        next.undefined = context.undefs.size ();
+        link_state::write (next, path);
+        std::chrono::duration<double, std::milli> const elapsed =
+            std::chrono::steady_clock::now () - start;
+        print ("Link state: ", next.files.size (), " files saved in ", elapsed.count (), "ms");
+    }
+
+    void write_chrome_trace (std::string const & path) {
+        std::ofstream os{path};
+        timeline::recorder::get ().write_chrome_trace (os);
+        if (!os) {
+            throw std::runtime_error{path + ": could not write the timeline"};
+        }
+    }
+
+    /// Looks up each of the compilations named by \p inputs in \p repo, along with the fragments
+    /// that they define and the names that they define and reference. A repository mapped from a
+    /// file need not match the link's inputs: a missing entry then throws here, on the main
+    /// thread, rather than in a resolution or layout task.
+    void check_repository (repository_view const & repo, link_inputs const & inputs) {
+        timeline::scope const _{"check repository"};
+        for (auto const * const crs : {&inputs.tickets, &inputs.members}) {
+            for (compilationref const & cr : *crs) {
+                for (auto const & definition : repo.definitions (cr.compilation)) {
+                    repo.name (definition.name);
+                    for (address const ref : repo.references (definition.fragment)) {
+                        repo.name (ref);
+                    }
+                }
+            }
+        }
+    }
 
     void show_compilation_group (unsigned const ngroup,
                                  std::vector<compilationref *> const & group) {
+        if (!trace.enabled ()) {
+            return;
+        }
         std::vector<digest> group_compilations;
 
         group_compilations.reserve (group.size ());
         std::transform (std::begin (group), std::end (group),
                         std::back_inserter (group_compilations),
                         [] (compilationref const * const cr) { return cr->compilation; });
-        print ("Group ", ngroup, " compilations: ",
-               make_range (std::cbegin (group_compilations), std::cend (group_compilations)));
+        RLD_TRACE ("Group ", ngroup, " compilations: ",
+                   make_range (std::cbegin (group_compilations), std::cend (group_compilations)));
     }
 
-} // end anonymous namespace
+    /// \param origins  If not null, receives the origin of the compilation assigned to each
+    ///   ordinal.
+    int link (options const & opts, std::vector<std::string> * const origins = nullptr) {
+        trace.enable (!opts.quiet);
+        if (!opts.delays) {
+            delay = delays{0s, 0s, 0s, 0s};
+        }
+        batch_updates = opts.batch_shadow;
 
-int main () {
-    print ("Main Thread");
-
-    context context{build_repository};
-
-    std::list<compilationref> x;
-    compilationref * fptr = &x.emplace_back (compilation_digests[f], "f.o"s, arch_position{0, 0});
-    std::vector<compilationref *> const ticketed_compilations{fptr};
-
-    // | Ticket  | Position  |
-    // | --------| --------- |
-    // | f.o     | (0,0)     |
-    //
-    // | Archive | File members | Position     |
-    // | ------- | ------------ | ------------ |
-    // | liba.a  | g.o j.o      | (1,0), (1,1) |
-    // | libb.a  | h.o          | (2,0)        |
-    // | libc.a  | g.o          | (3,0)        |
-    //
-    // These are provided (albeit indirectly) on the command-line.
-
-    // Position x=0 is assigned to the ticket files on the command line.
-    constexpr auto liba = 1U;
-    constexpr auto libb = 2U;
-    constexpr auto libc = 3U;
-    assert ((arch_position{0, 1} < arch_position{1, 0}));
-
-    std::vector<compilationref> const archives{
-        compilationref{compilation_digests[g], "liba.a(g.o)"s, std::make_pair (liba, 0U)},
-        compilationref{compilation_digests[j], "liba.a(j.o)"s, std::make_pair (liba, 1U)},
-        compilationref{compilation_digests[h], "libb.a(h.o)"s, std::make_pair (libb, 0U)},
-        compilationref{compilation_digests[g], "libc.a(g.o)"s, std::make_pair (libc, 0U)},
-    };
+        auto const generate_start = std::chrono::steady_clock::now ();
+        link_inputs inputs = opts.generate ? generate (opts.generator) : demo_inputs ();
+        if (opts.generate) {
+            std::chrono::duration<double, std::milli> const generate_time =
+                std::chrono::steady_clock::now () - generate_start;
+            print ("Generated: ", opts.generator, " in ", generate_time.count (), "ms (",
+                   inputs.tickets.size (), " tickets, ", inputs.members.size (),
+                   " archive members)");
+        }
+        if (!opts.archive_index_path.empty ()) {
+            std::filesystem::create_directories (opts.archive_index_path);
+        }
+        if (!opts.write_repo_path.empty ()) {
+            repo_file::write (inputs.repo, opts.write_repo_path);
+            return EXIT_SUCCESS;
+        }
 
+        RLD_TRACE ("Main Thread");
+        timeline::recorder & recorder = timeline::recorder::get ();
+        recorder.enable (!opts.chrome_trace_path.empty ());
+        recorder.name_thread ("main");
+        shadow::contention_stats::get ().enable (opts.contention_report > 0U);
 
-    auto ngroup = 0U;
-    group_set next_group;
+        auto const start_time = std::chrono::steady_clock::now ();
+        context context{[&opts, &inputs] () -> std::unique_ptr<repository_view const> {
+                            if (!opts.repo_path.empty ()) {
+                                return std::make_unique<mapped_repository> (
+                                    opts.repo_path);
+                            }
+                            return std::make_unique<repository> (std::move (inputs.repo));
+                        },
+                        opts.shadow, opts.shadow_size};
+        std::chrono::duration<double, std::milli> const startup =
+            std::chrono::steady_clock::now () - start_time;
+        print ("Startup: ", startup.count (), "ms (", context.shadow.size (), " bytes of ",
+               context.shadow.kind (), " shadow memory), RSS ", as_string (current_rss ()));
+        if (!opts.repo_path.empty ()) {
+            check_repository (*context.repo, inputs);
+        }
+
+        std::vector<compilationref *> ticketed_compilations;
+        ticketed_compilations.reserve (inputs.tickets.size ());
+        for (compilationref & ticket : inputs.tickets) {
+            ticketed_compilations.push_back (&ticket);
+        }
+        // Archive discovery points shadow memory at these compilationrefs: one per member.
+        std::vector<compilationref> & archives = inputs.members;
+
+        // If the state of a previous link can be reused, only the tickets which have changed
+        // since that link are resolved again.
+        auto const inputs_fingerprint = link_state::fingerprint (inputs.tickets, inputs.members);
+        std::optional<link_state::state> previous;
+        std::optional<std::vector<unsigned>> changed;
+        if (!opts.state_path.empty ()) {
+            auto const read_start = std::chrono::steady_clock::now ();
+            previous = link_state::read (opts.state_path);
+            if (previous) {
+                std::string reason;
+                changed = link_state::changed_files (*previous, inputs_fingerprint, inputs.tickets,
+                                                     *context.repo, reason);
+                std::chrono::duration<double, std::milli> const read_time =
+                    std::chrono::steady_clock::now () - read_start;
+                if (changed) {
+                    print ("Incremental link: ", changed->size (), " of ", previous->files.size (),
+                           " files changed (state read in ", read_time.count (), "ms)");
+                } else {
+                    print ("Full link: ", reason);
+                }
+            }
+        }
 
-    auto group = ticketed_compilations;
-    auto ordinal = 0U;
+        auto ngroup = 0U;
+        group_set next_group{context.shadow.data ()};
 
-    // At this point, 'group' holds the collection of compilations that we'll be
-    // resolving as group 0.
-    //
-    // Next, create the threads that will inspect the contents of the archives
-    // that were listed on the (pretend) command-line.
-    bool archives_joined = false;
-    auto archive_threads = create_arch_threads (context, archives, &next_group);
-    do {
-        show_compilation_group (ngroup, group);
+        auto group = ticketed_compilations;
+        auto ordinal = 0U;
 
-        std::vector<std::thread> workers;
-        for (compilationref * const & compilation : group) {
-            workers.emplace_back (symbol_resolution, std::ref (context), compilation,
-                                             ordinal++, &next_group);
+        task_pool pool{opts.threads > 0U ? opts.threads : task_pool::default_workers ()};
+        print ("Task pool with ", pool.size (), " workers");
+
+        // The completion time of each file, recorded if a trace is to be written.
+        std::optional<per_thread<std::vector<TraceRecord>>> completions;
+        if (!opts.visited_trace_path.empty ()) {
+            completions.emplace ();
         }
-        join_all (std::begin (workers), std::end (workers));
 
-        if (!archives_joined) {
-            print ("Join Archive Discovery");
-            join_all (std::begin (archive_threads), std::end (archive_threads));
-            archives_joined = true;
+        // The layout stage consumes files in ordinal order as symbol resolution completes them.
+        auto const link_start = std::chrono::steady_clock::now ();
+        Visited visited;
+        layout_result laid_out;
+        std::thread layout_thread;
+        auto const start_layout = [&] {
+            layout_thread =
+                std::thread{[&] { laid_out = layout (context, visited, delay.layout); }};
+        };
+        if (opts.pipeline) {
+            start_layout ();
         }
 
-        group.clear ();
-        next_group.for_each ([&group] (std::atomic<void *> * const p) {
-            if (compilationref * const cr = shadow::as_compilationref (*p)) {
-                group.emplace_back (cr);
+        // Records that the file with ordinal 'o' in group 'g' is ready for layout.
+        auto const record_completion = [&completions, link_start] (unsigned const o,
+                                                                   unsigned const g) {
+            if (completions) {
+                auto const elapsed = std::chrono::duration_cast<std::chrono::microseconds> (
+                    std::chrono::steady_clock::now () - link_start);
+                completions->local ().push_back (
+                    TraceRecord{o, g, static_cast<std::uint64_t> (elapsed.count ())});
             }
+        };
+
+        // The group in which each file was resolved.
+        std::vector<unsigned> groups;
+        if (changed) {
+            link_state::restore (*previous, *changed, inputs.tickets, inputs.members, context);
+            ordinal = static_cast<unsigned> (previous->files.size ());
+            // The files which have not changed are ready for layout at once.
+            auto const unchanged = [&] (unsigned const first, unsigned const last) {
+                visited.fileCompletedRange (first, last);
+                for (auto o = first; o < last; ++o) {
+                    record_completion (o, previous->files[o].group);
+                }
+            };
+            auto first = 0U;
+            task_group resolution_tasks;
+            for (unsigned const c : *changed) {
+                unchanged (first, c);
+                first = c + 1U;
+                pool.submit (resolution_tasks, [&context, &inputs, c,
+                                                group = previous->files[c].group, &next_group,
+                                                &visited, &record_completion] {
+                    symbol_resolution (context, &inputs.tickets[c], c, &next_group, &visited,
+                                       nullptr);
+                    record_completion (c, group);
+                });
+            }
+            unchanged (first, ordinal);
+            resolution_tasks.wait ();
+        } else {
+            // At this point, 'group' holds the collection of compilations that we'll be
+            // resolving as group 0.
+            //
+            // Next, submit the tasks that will inspect the contents of the archives
+            // that were listed on the (pretend) command-line.
+            bool archives_joined = false;
+            task_group archive_tasks;
+            discovery_status status;
+            std::vector<std::vector<compilationref *>> const members_by_archive =
+                group_by_archive (archives);
+            std::vector<std::unique_ptr<archive_index>> indices;
+            std::optional<lazy_archives> lazy;
+            if (opts.lazy_archives) {
+                lazy.emplace (*context.repo, archives);
+                submit_lazy_archive_discovery (pool, archive_tasks, context, &*lazy, &status);
+            } else if (opts.archive_index_path.empty ()) {
+                submit_archive_discovery (pool, archive_tasks, context, archives, &next_group,
+                                          &status);
+            } else {
+                indices.resize (members_by_archive.size ());
+                submit_indexed_archive_discovery (pool, archive_tasks, context,
+                                                  opts.archive_index_path, members_by_archive,
+                                                  indices, &next_group, &status);
+            }
+            do {
+                timeline::scope const group_scope{"group", "group", ngroup};
+                show_compilation_group (ngroup, group);
+
+                // The lookup table may be used only once lazy discovery has completed.
+                lazy_archives const * const resolve_lazy =
+                    archives_joined && lazy ? &*lazy : nullptr;
+                task_group resolution_tasks;
+                for (compilationref * const compilation : group) {
+                    context.files_by_ordinal[ordinal] = compilation;
+                    groups.push_back (ngroup);
+                    pool.submit (resolution_tasks, [&context, compilation, ordinal = ordinal++,
+                                                     group_number = ngroup, &next_group, &visited,
+                                                     &record_completion, resolve_lazy] {
+                        symbol_resolution (context, compilation, ordinal, &next_group, &visited,
+                                           resolve_lazy);
+                        record_completion (ordinal, group_number);
+                    });
+                }
+                {
+                    timeline::scope const _{"join symbol resolution", "group", ngroup};
+                    resolution_tasks.wait ();
+                }
+                if (!archives_joined) {
+                    RLD_TRACE ("Join Archive Discovery");
+                    timeline::scope const _{"join archive discovery"};
+                    if (context.undefs.empty ()) {
+                        // Nothing remains for the archives to define.
+                        status.cancel ();
+                    }
+                    archive_tasks.wait ();
+                    archives_joined = true;
+                    show_discovery (status, archives.size (), indices, lazy);
+                    if (lazy && !status.cancelled ()) {
+                        lazy_archive_catch_up (context, *lazy, &next_group);
+                    }
+                }
+
+                group.clear ();
+                next_group.for_each ([&group] (std::atomic<void *> * const p) {
+                    if (compilationref * const cr = shadow::as_compilationref (*p)) {
+                        group.emplace_back (cr);
+                    }
+                });
+                sort_group (group, pool);
+                next_group.clear ();
+                ++ngroup;
+            } while (!group.empty () && !context.undefs.empty ());
+        }
+
+        visited.done ();
+        if (origins != nullptr) {
+            origins->reserve (ordinal);
+            for (auto o = 0U; o < ordinal; ++o) {
+                origins->push_back (context.files_by_ordinal[o]->origin ());
+            }
+        }
+        std::chrono::duration<double, std::milli> const resolve_time =
+            std::chrono::steady_clock::now () - link_start;
+        if (!opts.pipeline) {
+            start_layout ();
+        }
+        layout_thread.join ();
+        std::chrono::duration<double, std::milli> const link_time =
+            std::chrono::steady_clock::now () - link_start;
+        print ("Resolution: ", resolve_time.count (), "ms, ",
+               opts.pipeline ? "pipelined" : "sequential", " layout of ", laid_out.files,
+               " files (", laid_out.size, " bytes) complete at ", link_time.count (), "ms");
+
+        if (completions) {
+            write_visited_trace (opts.visited_trace_path, *completions);
+        }
+        if (!opts.state_path.empty ()) {
+            write_link_state (opts.state_path, context, inputs, inputs_fingerprint,
+                              std::move (previous), changed, groups, ordinal);
+        }
+
+        int exit_code = EXIT_SUCCESS;
+        bool first = true;
+        auto const by_name = [&context] (address const a, address const b) {
+            return context.name (a) < context.name (b);
+        };
+        context.undefs.for_each_sorted (by_name, [&] (address const name) {
+            if (first) {
+                first = false;
+                print ("Error. Undefined symbols:");
+            }
+            print (context.name (name));
+            exit_code = EXIT_FAILURE;
         });
-        next_group.clear ();
-        ++ngroup;
-    } while (!group.empty () && !context.undefs.empty ());
-
-    int exit_code = EXIT_SUCCESS;
-    bool first = true;
-    context.undefs.for_each ([&] (address const name) {
-        if (first) {
-            first = false;
-            print ("Error. Undefined symbols:");
-        }
-        print (context.name (name));
-        exit_code = EXIT_FAILURE;
-    });
-    if (exit_code == EXIT_SUCCESS) {
-        print ("We have success!");
-    }
-    return exit_code;
+        if (opts.audit && !audit_shadow (context, pool, *opts.audit)) {
+            exit_code = EXIT_FAILURE;
+        }
+        if (exit_code == EXIT_SUCCESS) {
+            print ("We have success!");
+        }
+
+        print ("Heap allocations: ", allocation_count ());
+        print ("Symbol table: ", context.symbols.size (), " symbols, ",
+               context.symbols.bytes_allocated (), " bytes allocated");
+        print ("Peak RSS: ", as_string (peak_rss ()));
+        if (opts.contention_report > 0U) {
+            show_contention (context, opts.contention_report);
+        }
+        return exit_code;
+    }
+
+    /// Runs the link opts.verify_determinism times and checks that every run assigns the same
+    /// compilation to each ordinal.
+    int verify_determinism (options const & opts) {
+        std::vector<std::string> expected;
+        for (auto run = 0U; run < opts.verify_determinism; ++run) {
+            std::vector<std::string> origins;
+            if (link (opts, &origins) != EXIT_SUCCESS) {
+                return EXIT_FAILURE;
+            }
+            if (run == 0U) {
+                expected = std::move (origins);
+                continue;
+            }
+            if (origins != expected) {
+                auto const size = std::min (origins.size (), expected.size ());
+                auto o = std::size_t{0};
+                while (o < size && origins[o] == expected[o]) {
+                    ++o;
+                }
+                print ("Determinism check failed: run ", run, " assigned ordinal ", o, " to \"",
+                       o < origins.size () ? origins[o] : "(none)", "\" rather than \"",
+                       o < expected.size () ? expected[o] : "(none)", '"');
+                return EXIT_FAILURE;
+            }
+        }
+        print ("Determinism check: ", opts.verify_determinism, " runs assigned the same ",
+               expected.size (), " ordinals");
+        return EXIT_SUCCESS;
+    }
+
+} // end anonymous namespace
+
+int main (int argc, char ** argv) {
+    std::optional<options> const opts = parse_options (argc, argv);
+    if (!opts) {
+        usage (argv[0]);
+        return EXIT_FAILURE;
+    }
+    try {
+        int const exit_code =
+            opts->verify_determinism > 0U ? verify_determinism (*opts) : link (*opts);
+        // The timeline is written once the task pool has been destroyed so that no thread is
+        // still recording.
+        if (!opts->chrome_trace_path.empty ()) {
+            write_chrome_trace (opts->chrome_trace_path);
+        }
+        flush_log ();
+        return exit_code;
+    } catch (std::exception const & ex) {
+        flush_log ();
+        std::cerr << "Error: " << ex.what () << '\n';
+    }
+    return EXIT_FAILURE;
 }
@@ -0,0 +1,63 @@
+#include "mapped_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define MAPPED_FILE_HAVE_MMAP 1
+#endif
+
+namespace {
+
+    [[noreturn]] void fail (std::string const & path, char const * const what) {
+        throw std::runtime_error{path + ": " + what + " (" + std::strerror (errno) + ')'};
+    }
+
+} // end anonymous namespace
+
+mapped_file::mapped_file (std::string const & path) {
+#if defined(MAPPED_FILE_HAVE_MMAP)
+    int const fd = ::open (path.c_str (), O_RDONLY);
+    if (fd == -1) {
+        fail (path, "could not open");
+    }
+    struct stat st {};
+    if (::fstat (fd, &st) == -1) {
+        ::close (fd);
+        fail (path, "could not stat");
+    }
+    size_ = static_cast<std::size_t> (st.st_size);
+    if (size_ > 0U) {
+        void * const p = ::mmap (nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close (fd);
+            fail (path, "could not map");
+        }
+        data_ = static_cast<std::uint8_t const *> (p);
+        mapped_ = true;
+    }
+    ::close (fd);
+#else
+    std::ifstream is{path, std::ios::binary};
+    if (!is) {
+        fail (path, "could not open");
+    }
+    buffer_.assign (std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{});
+    data_ = buffer_.data ();
+    size_ = buffer_.size ();
+#endif
+}
+
+mapped_file::~mapped_file () noexcept {
+#if defined(MAPPED_FILE_HAVE_MMAP)
+    if (mapped_) {
+        ::munmap (const_cast<std::uint8_t *> (data_), size_);
+    }
+#endif
+}
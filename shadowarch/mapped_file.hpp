@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// A read-only view of the entire contents of a file. Where the host supports it, the file is
+/// memory-mapped so that its pages are loaded on demand; otherwise it is read into memory.
+class mapped_file {
+public:
+    /// \throws std::runtime_error if the file could not be opened or mapped.
+    explicit mapped_file (std::string const & path);
+    mapped_file (mapped_file const &) = delete;
+    mapped_file (mapped_file &&) = delete;
+    ~mapped_file () noexcept;
+
+    mapped_file & operator= (mapped_file const &) = delete;
+    mapped_file & operator= (mapped_file &&) = delete;
+
+    std::uint8_t const * data () const noexcept { return data_; }
+    std::size_t size () const noexcept { return size_; }
+
+private:
+    std::uint8_t const * data_ = nullptr;
+    std::size_t size_ = 0U;
+    bool mapped_ = false;
+    std::vector<std::uint8_t> buffer_;
+};
+
+#endif // MAPPED_FILE_HPP
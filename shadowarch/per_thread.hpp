@@ -0,0 +1,86 @@
+#ifndef PER_THREAD_HPP
+#define PER_THREAD_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+/// Provides one instance of T for each thread that asks for one. After the first call from a
+/// given thread, local() is a thread-local cache hit and takes no lock. Instances live until the
+/// per_thread<> object is destroyed.
+template <typename T>
+class per_thread {
+public:
+    per_thread () = default;
+    per_thread (per_thread const &) = delete;
+    per_thread (per_thread &&) = delete;
+    ~per_thread () noexcept = default;
+
+    per_thread & operator= (per_thread const &) = delete;
+    per_thread & operator= (per_thread &&) = delete;
+
+    /// Returns the calling thread's instance, constructing it from \p args on first use.
+    template <typename... Args>
+    T & local (Args &&... args) {
+        if (cache.owner == id_) {
+            return *cache.instance;
+        }
+        T & instance = this->find_or_create (std::forward<Args> (args)...);
+        cache.owner = id_;
+        cache.instance = &instance;
+        return instance;
+    }
+
+    /// Calls \p function (std::thread::id, T &) for each of the per-thread instances. The caller
+    /// must ensure that the instances are not being modified by their owning threads.
+    template <typename Function>
+    void for_each (Function function) {
+        std::lock_guard<std::mutex> _{mutex_};
+        for (auto & entry : instances_) {
+            function (entry.first, entry.second);
+        }
+    }
+
+private:
+    template <typename... Args>
+    T & find_or_create (Args &&... args) {
+        auto const tid = std::this_thread::get_id ();
+        std::lock_guard<std::mutex> _{mutex_};
+        for (auto & entry : instances_) {
+            if (entry.first == tid) {
+                return entry.second;
+            }
+        }
+        instances_.emplace_back (std::piecewise_construct, std::forward_as_tuple (tid),
+                                 std::forward_as_tuple (std::forward<Args> (args)...));
+        return instances_.back ().second;
+    }
+
+    static std::uint64_t next_id () noexcept {
+        static std::atomic<std::uint64_t> count{0};
+        return count.fetch_add (1U, std::memory_order_relaxed) + 1U;
+    }
+
+    /// A single-entry cache mapping the most recently used per_thread<T> object to the calling
+    /// thread's instance. An id of 0 is never allocated so that the initial cache is a miss.
+    struct cache_entry {
+        std::uint64_t owner = 0U;
+        T * instance = nullptr;
+    };
+    static thread_local cache_entry cache;
+
+    /// A process-wide unique identifier for this object. Unlike its address, this can't be reused
+    /// by a later per_thread<T> and so produce a stale cache hit.
+    std::uint64_t const id_ = next_id ();
+    std::mutex mutex_;
+    std::list<std::pair<std::thread::id const, T>> instances_;
+};
+
+template <typename T>
+thread_local typename per_thread<T>::cache_entry per_thread<T>::cache;
+
+#endif // PER_THREAD_HPP
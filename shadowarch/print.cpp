@@ -6,3 +6,153 @@
 //
 
 #include "print.hpp"
+
+#include <iostream>
+#include <new>
+#include <streambuf>
+
+ios_printer<severity::report> print{std::cout, true /*enabled*/};
+ios_printer<severity::trace> trace{std::cout, true /*enabled*/};
+
+namespace {
+
+    /// A stream buffer which appends to a string. Unlike std::stringbuf, it keeps its capacity
+    /// when it is emptied.
+    class line_buffer final : public std::streambuf {
+    public:
+        std::string const & str () const noexcept { return s_; }
+        void clear () noexcept { s_.clear (); }
+
+    protected:
+        int_type overflow (int_type const c) override {
+            if (!traits_type::eq_int_type (c, traits_type::eof ())) {
+                s_.push_back (traits_type::to_char_type (c));
+            }
+            return traits_type::not_eof (c);
+        }
+        std::streamsize xsputn (char const * const s, std::streamsize const n) override {
+            s_.append (s, static_cast<std::size_t> (n));
+            return n;
+        }
+
+    private:
+        std::string s_;
+    };
+
+    struct line_stream {
+        line_buffer buffer;
+        std::ostream os{&buffer};
+    };
+
+    line_stream & local_line () {
+        static thread_local line_stream line;
+        return line;
+    }
+
+} // end anonymous namespace
+
+namespace details {
+
+    unsigned thread_id () {
+        static std::atomic<unsigned> thread_count{0};
+        static unsigned thread_local const id =
+            thread_count.fetch_add (1U, std::memory_order_relaxed);
+        return id;
+    }
+
+    log_queue::log_queue ()
+            : thread_{&log_queue::writer, this} {}
+
+    log_queue::~log_queue () noexcept {
+        stop_.store (true, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> _{mutex_};
+            wake_cv_.notify_one ();
+        }
+        thread_.join ();
+    }
+
+    log_queue & log_queue::get () {
+        static log_queue queue;
+        return queue;
+    }
+
+    std::ostream & log_queue::start_line () {
+        line_stream & line = local_line ();
+        line.buffer.clear ();
+        return line.os;
+    }
+
+    void log_queue::push (std::ostream & os) {
+        std::string const & line = local_line ().buffer.str ();
+        auto * const n = new (::operator new (sizeof (node) + line.size ()))
+            node{nullptr, &os, line.size ()};
+        std::copy (std::begin (line), std::end (line), n->text ());
+        pushed_.fetch_add (1U, std::memory_order_relaxed);
+        n->next = head_.load (std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak (n->next, n, std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+        }
+        // The writer sets sleeping_ before checking head_ for the last time. Either it sees our
+        // line or we see it and wake it.
+        if (sleeping_.load (std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> _{mutex_};
+            wake_cv_.notify_one ();
+        }
+    }
+
+    void log_queue::flush () {
+        auto const target = pushed_.load (std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock{mutex_};
+        written_cv_.wait (lock, [this, target] { return written_ >= target; });
+    }
+
+    void log_queue::writer () {
+        for (;;) {
+            node * list = head_.exchange (nullptr, std::memory_order_acquire);
+            if (list == nullptr) {
+                std::unique_lock<std::mutex> lock{mutex_};
+                sleeping_.store (true, std::memory_order_seq_cst);
+                wake_cv_.wait (lock, [this] {
+                    return head_.load (std::memory_order_seq_cst) != nullptr ||
+                           stop_.load (std::memory_order_seq_cst);
+                });
+                sleeping_.store (false, std::memory_order_relaxed);
+                if (head_.load (std::memory_order_relaxed) == nullptr &&
+                    stop_.load (std::memory_order_relaxed)) {
+                    return;
+                }
+                continue;
+            }
+
+            // The list is newest first: reverse it to write the lines in the order they were
+            // queued.
+            node * oldest = nullptr;
+            while (list != nullptr) {
+                node * const next = list->next;
+                list->next = oldest;
+                oldest = list;
+                list = next;
+            }
+            auto count = std::uint64_t{0};
+            std::ostream * previous = nullptr;
+            while (oldest != nullptr) {
+                node * const next = oldest->next;
+                if (previous != nullptr && previous != oldest->os) {
+                    previous->flush ();
+                }
+                previous = oldest->os;
+                previous->write (oldest->text (), static_cast<std::streamsize> (oldest->size));
+                ::operator delete (oldest);
+                oldest = next;
+                ++count;
+            }
+            previous->flush ();
+
+            std::lock_guard<std::mutex> _{mutex_};
+            written_ += count;
+            written_cv_.notify_all ();
+        }
+    }
+
+} // end namespace details
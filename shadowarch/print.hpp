@@ -2,19 +2,97 @@
 #define PRINT_HPP
 
 #include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <algorithm>
 #include <mutex>
 #include <ostream>
+#include <string>
+#include <thread>
 #include <utility>
 
+/// The severity of a log message. Lower severities are more important.
+enum class severity : unsigned { report = 0U, trace = 1U };
+
+// The most detailed severity compiled into the program. Output from more detailed printers is
+// discarded at compile time.
+#ifndef RLD_LOG_SEVERITY
+#define RLD_LOG_SEVERITY 1
+#endif
+constexpr auto max_severity = static_cast<severity> (RLD_LOG_SEVERITY);
+
+template <typename Iterator>
+struct print_range {
+    Iterator begin;
+    Iterator end;
+};
+
+namespace details {
+
+    /// Returns a small number which identifies the calling thread in the log.
+    unsigned thread_id ();
+
+    /// The lines written by every printer are queued here and written to their streams by a
+    /// background thread. Queuing a line is lock-free unless the writer thread is asleep.
+    class log_queue {
+    public:
+        static log_queue & get ();
+
+        log_queue (log_queue const &) = delete;
+        log_queue (log_queue &&) = delete;
+        ~log_queue () noexcept;
+
+        log_queue & operator= (log_queue const &) = delete;
+        log_queue & operator= (log_queue &&) = delete;
+
+        /// Empties the calling thread's formatting buffer and returns it.
+        static std::ostream & start_line ();
+        /// Queues the contents of the calling thread's buffer to be written to \p os.
+        void push (std::ostream & os);
+        /// Blocks until every line queued before the call has been written.
+        void flush ();
+
+    private:
+        /// A queued line. The characters of the line immediately follow the node in the same
+        /// allocation.
+        struct node {
+            node * next;
+            std::ostream * os;
+            std::size_t size;
+
+            char * text () noexcept { return reinterpret_cast<char *> (this + 1); }
+        };
+
+        log_queue ();
+        void writer ();
+
+        /// The most recently queued line. Lines are pushed onto this list and the writer takes
+        /// the whole list at once.
+        std::atomic<node *> head_{nullptr};
+        std::atomic<std::uint64_t> pushed_{0U};
+        std::atomic<bool> sleeping_{false};
+        std::atomic<bool> stop_{false};
+
+        std::mutex mutex_;
+        /// Wakes the writer thread.
+        std::condition_variable wake_cv_;
+        /// Signals that written_ has increased.
+        std::condition_variable written_cv_;
+        /// The number of lines written. Guarded by mutex_.
+        std::uint64_t written_ = 0U;
+
+        std::thread thread_;
+    };
+
+} // end namespace details
+
+template <severity Severity>
 class ios_printer {
 public:
-    template <typename Iterator>
-    struct range {
-        Iterator begin;
-        Iterator end;
-    };
+    /// True if this printer's output is compiled into the program.
+    static constexpr bool compiled_in = Severity <= max_severity;
 
     explicit ios_printer (std::ostream & os, bool enabled = true) noexcept
             : os_{os}
@@ -25,50 +103,72 @@ public:
     ios_printer & operator= (ios_printer const &) = delete;
     ios_printer & operator= (ios_printer &&) = delete;
 
-    /// Writes one or more values to the output stream followed by a newline.
+    /// Writes one or more values to the output stream followed by a newline. The values are
+    /// formatted by the calling thread and the line is written asynchronously.
     template <typename... Args>
-    std::ostream & operator() (Args &&... args) {
-        std::lock_guard<std::mutex> _{mutex_};
-        if (!enabled_) {
-            return os_;
+    void operator() (Args &&... args) {
+        if constexpr (compiled_in) {
+            if (!this->enabled ()) {
+                return;
+            }
+            std::ostream & os = details::log_queue::start_line ();
+            os << details::thread_id () << "> ";
+            print_one (os, std::forward<Args> (args)...) << '\n';
+            details::log_queue::get ().push (os_);
         }
-        os_ << thread_id () << "> ";
-        return this->print_one (std::forward<Args> (args)...) << '\n';
     }
 
-private:
-    static unsigned thread_id () {
-        static std::atomic<unsigned> thread_count{0};
-        static unsigned thread_local const id =
-            thread_count.fetch_add (1U, std::memory_order_relaxed);
-        return id;
+    bool enabled () const noexcept {
+        return compiled_in && enabled_.load (std::memory_order_relaxed);
+    }
+    void enable (bool const enabled) noexcept {
+        enabled_.store (enabled, std::memory_order_relaxed);
     }
 
-
-    std::ostream & print_one () { return os_; }
+private:
+    static std::ostream & print_one (std::ostream & os) { return os; }
 
     template <typename Iterator, typename... Args>
-    std::ostream & print_one (range<Iterator> && r, Args &&... args) {
+    static std::ostream & print_one (std::ostream & os, print_range<Iterator> && r,
+                                     Args &&... args) {
         std::copy (
             r.begin, r.end,
-            std::ostream_iterator<typename std::iterator_traits<Iterator>::value_type> (os_, " "));
-        return print_one (std::forward<Args> (args)...);
+            std::ostream_iterator<typename std::iterator_traits<Iterator>::value_type> (os, " "));
+        return print_one (os, std::forward<Args> (args)...);
     }
 
     template <typename A0, typename... Args>
-    std::ostream & print_one (A0 && a0, Args &&... args) {
-        os_ << a0;
-        return print_one (std::forward<Args> (args)...);
+    static std::ostream & print_one (std::ostream & os, A0 && a0, Args &&... args) {
+        os << a0;
+        return print_one (os, std::forward<Args> (args)...);
     }
 
-    std::mutex mutex_;
     std::ostream & os_;
-    bool enabled_ = false;
+    std::atomic<bool> enabled_{false};
 };
 
+/// The driver's report output.
+extern ios_printer<severity::report> print;
+/// The driver's detailed log of each step of the link. May be disabled for large links.
+extern ios_printer<severity::trace> trace;
+
+/// Writes to the trace log. Unlike a direct call to trace(), the arguments are evaluated only if
+/// the trace log is enabled.
+#define RLD_TRACE(...)                                                                             \
+    do {                                                                                           \
+        if (trace.enabled ()) {                                                                    \
+            trace (__VA_ARGS__);                                                                   \
+        }                                                                                          \
+    } while (false)
+
+/// Blocks until all of the output queued by print and trace has been written.
+inline void flush_log () {
+    details::log_queue::get ().flush ();
+}
+
 template <typename Iterator>
 auto make_range (Iterator begin, Iterator end) {
-    return ios_printer::range<Iterator>{begin, end};
+    return print_range<Iterator>{begin, end};
 }
 
 #endif // PRINT_HPP
@@ -1,5 +1,34 @@
 #include "repo.hpp"
 
-std::ostream & operator<< (std::ostream & os, digest const d) {
-    return os << d.v;
+#include <limits>
+
+namespace {
+
+    template <typename Value>
+    bool add_entry (std::vector<std::pair<digest, Value>> & entries, digest_index & index,
+                    digest const d, Value && value) {
+        assert (entries.size () < std::numeric_limits<std::uint32_t>::max () &&
+                "too many repository entries");
+        if (!index.insert (d, static_cast<std::uint32_t> (entries.size ()))) {
+            return false;
+        }
+        entries.emplace_back (d, std::move (value));
+        return true;
+    }
+
+} // end anonymous namespace
+
+void repository::reserve (std::size_t const compilations, std::size_t const fragments) {
+    compilations_.reserve (compilations);
+    compilation_index_.reserve (compilations);
+    fragments_.reserve (fragments);
+    fragment_index_.reserve (fragments);
+}
+
+bool repository::add (digest const d, fragment && f) {
+    return add_entry (fragments_, fragment_index_, d, std::move (f));
+}
+
+bool repository::add (digest const d, compilation && c) {
+    return add_entry (compilations_, compilation_index_, d, std::move (c));
 }
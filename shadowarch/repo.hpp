@@ -1,12 +1,21 @@
 #ifndef REPO_HPP
 #define REPO_HPP
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <ostream>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "digest.hpp"
+#include "digest_index.hpp"
+#include "span.hpp"
+
 struct address {
     constexpr std::uintptr_t raw () const noexcept { return v; }
 
@@ -25,24 +34,12 @@ struct std::hash<address> {
     }
 };
 
-struct digest {
-    constexpr bool operator== (digest const rhs) const noexcept { return v == rhs.v; }
-    constexpr bool operator!= (digest const rhs) const noexcept { return !operator== (rhs); }
-
-    unsigned long v;
-};
-
-std::ostream & operator<< (std::ostream & os, digest const d);
-
-template <>
-struct std::hash<digest> {
-    std::size_t operator() (digest d) const noexcept { return std::hash<decltype (d.v)>{}(d.v); }
-};
-
 
 struct fragment {
     fragment (std::initializer_list<address> && references_)
             : references{references_} {}
+    explicit fragment (std::vector<address> && references_) noexcept
+            : references{std::move (references_)} {}
 
     std::vector<address> const references;
 };
@@ -58,28 +55,93 @@ struct compilation {
 
     explicit compilation (std::initializer_list<definition> && definitions_)
             : definitions{definitions_} {}
+    explicit compilation (std::vector<definition> && definitions_) noexcept
+            : definitions{std::move (definitions_)} {}
 
     std::vector<definition> const definitions;
 };
 
-struct repository {
+/// Read-only access to the contents of a repository regardless of how it is stored.
+class repository_view {
+public:
+    repository_view () = default;
+    repository_view (repository_view const &) = delete;
+    repository_view (repository_view &&) noexcept = default;
+    virtual ~repository_view () noexcept = default;
+
+    repository_view & operator= (repository_view const &) = delete;
+    repository_view & operator= (repository_view &&) noexcept = default;
+
+    /// Returns the definitions belonging to the compilation with the given digest.
+    virtual span<compilation::definition const> definitions (digest compilation) const = 0;
+    /// Returns the references made by the fragment with the given digest.
+    virtual span<address const> references (digest fragment) const = 0;
+    /// Returns the string at the given address.
+    virtual std::string_view name (address n) const = 0;
+    /// The size of the repository's address space. Shadow memory must be at least this large.
+    virtual std::size_t extent () const noexcept = 0;
+};
+
+/// A repository built in memory.
+///
+/// Compilations and fragments are held in arrays in the order in which they were added. Each
+/// array is keyed by a digest_index so that a lookup is a short linear probe followed by a single
+/// array access.
+struct repository final : public repository_view {
+    using compilation_entry = std::pair<digest, compilation>;
+    using fragment_entry = std::pair<digest, fragment>;
+
     repository () = default;
     repository (repository const & rhs) = delete;
-    repository (repository && rhs) noexcept
-            : names{std::move (rhs.names)}
-            , fragments{std::move (rhs.fragments)}
-            , compilations{std::move (rhs.compilations)}
-            , size{rhs.size} {}
+    repository (repository && rhs) noexcept = default;
 
-    ~repository () noexcept = default;
+    ~repository () noexcept override = default;
 
     repository & operator= (repository const &) = delete;
     repository & operator= (repository &&) noexcept = delete;
 
+    /// Allocates space for the given number of compilations and fragments.
+    void reserve (std::size_t compilations, std::size_t fragments);
+
+    /// Adds a fragment to the repository.
+    /// \returns False if a fragment with the same digest is already present. In that case \p f
+    ///   is not moved from.
+    bool add (digest d, fragment && f);
+    /// Adds a compilation to the repository.
+    /// \returns False if a compilation with the same digest is already present. In that case
+    ///   \p c is not moved from.
+    bool add (digest d, compilation && c);
+
+    span<compilation::definition const> definitions (digest const compilation) const override {
+        auto const index = compilation_index_.find (compilation);
+        assert (index != digest_index::npos && "compilation was not found");
+        auto const & definitions = compilations_[index].second.definitions;
+        return {definitions.data (), definitions.size ()};
+    }
+    span<address const> references (digest const fragment) const override {
+        auto const index = fragment_index_.find (fragment);
+        assert (index != digest_index::npos && "fragment was not found");
+        auto const & references = fragments_[index].second.references;
+        return {references.data (), references.size ()};
+    }
+    std::string_view name (address const n) const override { return names.find (n)->second; }
+    std::size_t extent () const noexcept override { return size; }
+
+    /// The compilations in the order in which they were added.
+    std::vector<compilation_entry> const & compilations () const noexcept {
+        return compilations_;
+    }
+    /// The fragments in the order in which they were added.
+    std::vector<fragment_entry> const & fragments () const noexcept { return fragments_; }
+
     std::unordered_map<address, std::string> names;
-    std::unordered_map<digest, fragment> fragments;
-    std::unordered_map<digest, compilation> compilations;
     std::size_t size = 0U;
+
+private:
+    std::vector<fragment_entry> fragments_;
+    digest_index fragment_index_;
+    std::vector<compilation_entry> compilations_;
+    digest_index compilation_index_;
 };
 
 #endif // REPO_HPP
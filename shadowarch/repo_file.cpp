@@ -0,0 +1,274 @@
+#include "repo_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+    // The tables are written and read as raw arrays so their layouts must be fixed.
+    static_assert (sizeof (address) == 8U && sizeof (digest) == 8U,
+                   "The repository file format requires 64-bit addresses and digests");
+    static_assert (sizeof (compilation::definition) == 16U &&
+                       std::is_trivially_copyable_v<compilation::definition>,
+                   "compilation::definition must be stored as two 64-bit fields");
+    static_assert (sizeof (repo_file::name_entry) == 24U && sizeof (repo_file::index_entry) == 24U);
+    static_assert (sizeof (digest_index::slot) == 16U);
+
+    constexpr bool is_power_of_two (std::uint64_t const v) noexcept {
+        return v != 0U && (v & (v - 1U)) == 0U;
+    }
+
+    constexpr std::uint64_t align8 (std::uint64_t const v) noexcept { return (v + 7U) & ~7U; }
+
+    template <typename T>
+    struct table_data {
+        repo_file::table t{};
+        std::vector<T> contents;
+    };
+
+    template <typename T>
+    void place (table_data<T> & td, std::uint64_t & offset) {
+        td.t = repo_file::table{offset, td.contents.size ()};
+        offset = align8 (offset + td.contents.size () * sizeof (T));
+    }
+
+    template <typename T>
+    void emit (std::ofstream & os, table_data<T> const & td) {
+        os.seekp (static_cast<std::streamoff> (td.t.offset));
+        os.write (reinterpret_cast<char const *> (td.contents.data ()),
+                  static_cast<std::streamsize> (td.contents.size () * sizeof (T)));
+    }
+
+    // Builds the hashed index for a table of index entries. The value of each slot is the position
+    // of the corresponding entry in the table.
+    table_data<digest_index::slot>
+    hash_index (std::vector<repo_file::index_entry> const & entries) {
+        digest_index index{entries.size ()};
+        for (auto ctr = std::size_t{0}; ctr < entries.size (); ++ctr) {
+            index.insert (entries[ctr].key, static_cast<std::uint32_t> (ctr));
+        }
+        table_data<digest_index::slot> result;
+        auto const slots = index.slots ();
+        result.contents.assign (std::begin (slots), std::end (slots));
+        return result;
+    }
+
+    template <typename Map>
+    std::vector<typename Map::key_type> sorted_keys (Map const & m) {
+        std::vector<typename Map::key_type> keys;
+        keys.reserve (m.size ());
+        std::transform (std::begin (m), std::end (m), std::back_inserter (keys),
+                        [] (auto const & kvp) { return kvp.first; });
+        std::sort (std::begin (keys), std::end (keys),
+                   [] (auto const & a, auto const & b) { return a.v < b.v; });
+        return keys;
+    }
+
+    [[noreturn]] void invalid (std::string const & path, char const * const what) {
+        throw std::runtime_error{path + ": " + what};
+    }
+
+} // end anonymous namespace
+
+namespace repo_file {
+
+    void write (repository const & repo, std::string const & path) {
+        table_data<name_entry> names;
+        table_data<char> strings;
+        for (address const n : sorted_keys (repo.names)) {
+            std::string const & s = repo.names.find (n)->second;
+            names.contents.push_back (name_entry{n, strings.contents.size (), s.length ()});
+            strings.contents.insert (std::end (strings.contents), std::begin (s), std::end (s));
+        }
+
+        table_data<index_entry> compilations;
+        table_data<compilation::definition> definitions;
+        for (auto const & [d, c] : repo.compilations ()) {
+            auto const & defs = c.definitions;
+            compilations.contents.push_back (
+                index_entry{d, definitions.contents.size (), defs.size ()});
+            definitions.contents.insert (std::end (definitions.contents), std::begin (defs),
+                                         std::end (defs));
+        }
+
+        table_data<index_entry> fragments;
+        table_data<address> references;
+        for (auto const & [d, f] : repo.fragments ()) {
+            auto const & refs = f.references;
+            fragments.contents.push_back (
+                index_entry{d, references.contents.size (), refs.size ()});
+            references.contents.insert (std::end (references.contents), std::begin (refs),
+                                        std::end (refs));
+        }
+
+        auto compilation_slots = hash_index (compilations.contents);
+        auto fragment_slots = hash_index (fragments.contents);
+
+        auto offset = align8 (sizeof (header));
+        place (names, offset);
+        place (compilation_slots, offset);
+        place (fragment_slots, offset);
+        place (compilations, offset);
+        place (fragments, offset);
+        place (definitions, offset);
+        place (references, offset);
+        place (strings, offset);
+
+        header h{};
+        std::memcpy (h.magic, header::magic_value, sizeof (h.magic));
+        h.version = header::current_version;
+        h.extent = repo.extent ();
+        h.names = names.t;
+        h.compilation_slots = compilation_slots.t;
+        h.fragment_slots = fragment_slots.t;
+        h.compilations = compilations.t;
+        h.fragments = fragments.t;
+        h.definitions = definitions.t;
+        h.references = references.t;
+        h.strings = strings.t;
+
+        std::ofstream os{path, std::ios::binary | std::ios::trunc};
+        if (!os) {
+            throw std::runtime_error{path + ": could not open for writing"};
+        }
+        os.write (reinterpret_cast<char const *> (&h), sizeof (h));
+        emit (os, names);
+        emit (os, compilation_slots);
+        emit (os, fragment_slots);
+        emit (os, compilations);
+        emit (os, fragments);
+        emit (os, definitions);
+        emit (os, references);
+        emit (os, strings);
+        // Pad the file so that its size is a multiple of 8.
+        os.seekp (static_cast<std::streamoff> (offset) - 1);
+        os.put ('\0');
+        if (!os) {
+            throw std::runtime_error{path + ": write failed"};
+        }
+    }
+
+} // end namespace repo_file
+
+mapped_repository::mapped_repository (std::string const & path)
+        : file_{path}
+        , header_{reinterpret_cast<repo_file::header const *> (file_.data ())} {
+    using namespace repo_file;
+    if (file_.size () < sizeof (header) ||
+        std::memcmp (header_->magic, header::magic_value, sizeof (header::magic_value)) != 0) {
+        invalid (path, "not a repository file");
+    }
+    if (header_->version != header::current_version) {
+        invalid (path, "unsupported repository file version");
+    }
+    auto const check = [&] (repo_file::table const & t, std::size_t const element_size) {
+        if (t.offset % 8U != 0U || t.offset > file_.size () ||
+            t.count > (file_.size () - t.offset) / element_size) {
+            invalid (path, "corrupt table");
+        }
+    };
+    check (header_->names, sizeof (name_entry));
+    check (header_->compilation_slots, sizeof (digest_index::slot));
+    check (header_->fragment_slots, sizeof (digest_index::slot));
+    check (header_->compilations, sizeof (index_entry));
+    check (header_->fragments, sizeof (index_entry));
+    check (header_->definitions, sizeof (compilation::definition));
+    check (header_->references, sizeof (address));
+    check (header_->strings, sizeof (char));
+    if (!is_power_of_two (header_->compilation_slots.count) ||
+        !is_power_of_two (header_->fragment_slots.count)) {
+        invalid (path, "corrupt index");
+    }
+
+    names_ = table_of<name_entry> (header_->names);
+    compilation_slots_ = table_of<digest_index::slot> (header_->compilation_slots);
+    fragment_slots_ = table_of<digest_index::slot> (header_->fragment_slots);
+    // A lookup of a missing digest probes until it reaches an empty slot.
+    auto const has_empty_slot = [] (span<digest_index::slot const> const & slots) {
+        return std::any_of (std::begin (slots), std::end (slots),
+                            [] (digest_index::slot const & s) {
+                                return s.value == digest_index::npos;
+                            });
+    };
+    if (!has_empty_slot (compilation_slots_) || !has_empty_slot (fragment_slots_)) {
+        invalid (path, "corrupt index");
+    }
+    compilations_ = table_of<index_entry> (header_->compilations);
+    fragments_ = table_of<index_entry> (header_->fragments);
+    definitions_ = table_of<compilation::definition> (header_->definitions);
+    references_ = table_of<address> (header_->references);
+    strings_ = table_of<char> (header_->strings);
+}
+
+namespace {
+
+    template <typename Entry, typename Key, typename Member>
+    Entry const * find (span<Entry const> const & index, Key const key, Member member) {
+        auto const it = std::lower_bound (
+            std::begin (index), std::end (index), key,
+            [member] (Entry const & e, Key const k) { return (e.*member).v < k.v; });
+        return it != std::end (index) && (it->*member).v == key.v ? it : nullptr;
+    }
+
+    repo_file::index_entry const * find (span<digest_index::slot const> const & slots,
+                                         span<repo_file::index_entry const> const & entries,
+                                         digest const key) {
+        auto const position = digest_index::lookup (slots, key);
+        return position < entries.size () ? &entries[position] : nullptr;
+    }
+
+    /// Reports a lookup of a key which is not in the repository. The repository file need not
+    /// match the link's inputs, so this is not a logic error.
+    template <typename Key>
+    [[noreturn]] void missing (char const * const what, Key const & key) {
+        std::ostringstream os;
+        os << "the repository file has no " << what << ' ' << key;
+        throw std::runtime_error{os.str ()};
+    }
+
+    /// Returns true if [first, first + count) lies within a table of \p size entries.
+    constexpr bool in_bounds (std::uint64_t const first, std::uint64_t const count,
+                              std::size_t const size) noexcept {
+        return count <= size && first <= size - count;
+    }
+
+} // end anonymous namespace
+
+span<compilation::definition const>
+mapped_repository::definitions (digest const compilation) const {
+    auto const * const entry = find (compilation_slots_, compilations_, compilation);
+    if (entry == nullptr || entry->key != compilation) {
+        missing ("compilation", compilation);
+    }
+    if (!in_bounds (entry->first, entry->count, definitions_.size ())) {
+        missing ("valid definitions for compilation", compilation);
+    }
+    return {definitions_.data () + entry->first, static_cast<std::size_t> (entry->count)};
+}
+
+span<address const> mapped_repository::references (digest const fragment) const {
+    auto const * const entry = find (fragment_slots_, fragments_, fragment);
+    if (entry == nullptr || entry->key != fragment) {
+        missing ("fragment", fragment);
+    }
+    if (!in_bounds (entry->first, entry->count, references_.size ())) {
+        missing ("valid references for fragment", fragment);
+    }
+    return {references_.data () + entry->first, static_cast<std::size_t> (entry->count)};
+}
+
+std::string_view mapped_repository::name (address const n) const {
+    auto const * const entry = find (names_, n, &repo_file::name_entry::name);
+    if (entry == nullptr) {
+        missing ("name at address", n.raw ());
+    }
+    if (!in_bounds (entry->offset, entry->length, strings_.size ())) {
+        missing ("valid string for the name at address", n.raw ());
+    }
+    return {strings_.data () + entry->offset, static_cast<std::size_t> (entry->length)};
+}
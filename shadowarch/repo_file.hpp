@@ -0,0 +1,102 @@
+#ifndef REPO_FILE_HPP
+#define REPO_FILE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "digest_index.hpp"
+#include "mapped_file.hpp"
+#include "repo.hpp"
+
+namespace repo_file {
+
+    // The on-disk repository format. All integers are stored in host byte order; every table is
+    // 8-byte aligned.
+    //
+    // +-------------------+
+    // | header            |
+    // +-------------------+
+    // | names             | name_entry[]: sorted by address
+    // | compilation slots | digest_index::slot[]: hashed index of the compilations table
+    // | fragment slots    | digest_index::slot[]: hashed index of the fragments table
+    // | compilations      | index_entry[]: indexes the definitions table
+    // | fragments         | index_entry[]: indexes the references table
+    // | definitions       | compilation::definition[]
+    // | references        | address[]
+    // | strings           | char[]: the text of each name
+    // +-------------------+
+
+    struct table {
+        std::uint64_t offset;
+        std::uint64_t count;
+    };
+
+    struct header {
+        static constexpr char magic_value[8] = {'R', 'L', 'D', 'R', 'E', 'P', 'O', '\0'};
+        static constexpr std::uint32_t current_version = 2U;
+
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t padding;
+        std::uint64_t extent;
+        table names;
+        table compilation_slots;
+        table fragment_slots;
+        table compilations;
+        table fragments;
+        table definitions;
+        table references;
+        table strings;
+    };
+
+    struct name_entry {
+        address name;
+        std::uint64_t offset; ///< The offset of the string within the strings table.
+        std::uint64_t length;
+    };
+
+    struct index_entry {
+        digest key;
+        std::uint64_t first; ///< The index of the first entry in the target table.
+        std::uint64_t count; ///< The number of entries in the target table.
+    };
+
+    /// Writes the in-memory repository \p repo to the file at \p path.
+    /// \throws std::runtime_error if the file could not be written.
+    void write (repository const & repo, std::string const & path);
+
+} // end namespace repo_file
+
+/// A repository which is read in place from a memory-mapped repository file. Opening the
+/// repository involves no deserialization: compilations and fragments are looked up by probing
+/// the file's hashed slot arrays and names by a binary search of its sorted names table.
+class mapped_repository final : public repository_view {
+public:
+    /// \throws std::runtime_error if the file could not be opened or is not a valid repository.
+    explicit mapped_repository (std::string const & path);
+
+    span<compilation::definition const> definitions (digest compilation) const override;
+    span<address const> references (digest fragment) const override;
+    std::string_view name (address n) const override;
+    std::size_t extent () const noexcept override { return header_->extent; }
+
+private:
+    template <typename T>
+    span<T const> table_of (repo_file::table const & t) const noexcept {
+        return {reinterpret_cast<T const *> (file_.data () + t.offset),
+                static_cast<std::size_t> (t.count)};
+    }
+
+    mapped_file file_;
+    repo_file::header const * header_;
+    span<repo_file::name_entry const> names_;
+    span<digest_index::slot const> compilation_slots_;
+    span<digest_index::slot const> fragment_slots_;
+    span<repo_file::index_entry const> compilations_;
+    span<repo_file::index_entry const> fragments_;
+    span<compilation::definition const> definitions_;
+    span<address const> references_;
+    span<char const> strings_;
+};
+
+#endif // REPO_FILE_HPP
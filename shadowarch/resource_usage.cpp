@@ -0,0 +1,35 @@
+#include "resource_usage.hpp"
+
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <sys/resource.h>
+#    include <unistd.h>
+#endif
+
+std::optional<std::size_t> current_rss () {
+#if defined(__linux__)
+    // The second field of /proc/self/statm is the number of resident pages.
+    std::ifstream statm{"/proc/self/statm"};
+    std::size_t size = 0;
+    std::size_t resident = 0;
+    if (statm >> size >> resident) {
+        return resident * static_cast<std::size_t> (::sysconf (_SC_PAGESIZE));
+    }
+#endif
+    return std::nullopt;
+}
+
+std::optional<std::size_t> peak_rss () {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage {};
+    if (::getrusage (RUSAGE_SELF, &usage) == 0) {
+#    if defined(__APPLE__)
+        return static_cast<std::size_t> (usage.ru_maxrss); // bytes
+#    else
+        return static_cast<std::size_t> (usage.ru_maxrss) * 1024U; // kilobytes
+#    endif
+    }
+#endif
+    return std::nullopt;
+}
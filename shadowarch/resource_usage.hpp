@@ -0,0 +1,12 @@
+#ifndef RESOURCE_USAGE_HPP
+#define RESOURCE_USAGE_HPP
+
+#include <cstddef>
+#include <optional>
+
+/// Returns the process's current resident set size in bytes, if the host can report it.
+std::optional<std::size_t> current_rss ();
+/// Returns the process's peak resident set size in bytes, if the host can report it.
+std::optional<std::size_t> peak_rss ();
+
+#endif // RESOURCE_USAGE_HPP
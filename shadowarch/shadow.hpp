@@ -2,8 +2,13 @@
 #define SHADOW_HPP
 
 #include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+#include "busy_wait.hpp"
+#include "symbol.hpp"
 
-class symbol;
 struct compilationref;
 
 namespace shadow {
@@ -22,19 +27,20 @@ namespace shadow {
     // |       +-----+------+            |
     // |       v            v            |
     // |  +---------+  +-----------------+
-    // +--| symbol* |  | compilationref* |
+    // +--| symbol  |  | compilationref* |
     //    +---------+  +-----------------+
     //
     // Notes:
     // (1) State changes from an undef symbol to busy and back to the same undef symbol.
     // (2) We can go from an compilationref to a defined symbol.
+    //
+    // A symbol is recorded as its symbol_handle shifted left by one bit (after adding one so
+    // that handle 0 is distinct from null). A compilationref is recorded as its address with the
+    // LSB set.
 
-    static_assert (
-        alignof (symbol) > 1U,
-        "The LSB of pointers is used to distinguish between compilationref* and symbol*");
     static_assert (
         alignof (compilationref) > 1U,
-        "The LSB of pointers is used to distinguish between compilationref* and symbol*");
+        "The LSB of pointers is used to distinguish between compilationref* and symbols");
     constexpr auto compilationref_mask = std::uintptr_t{0x01};
 
     inline compilationref * as_compilationref (void const * p) {
@@ -45,10 +51,17 @@ namespace shadow {
         return nullptr;
     }
 
+    /// Recovers the symbol handle from a shadow pointer value which is known to record a symbol.
+    inline symbol_handle as_symbol (void const * p) {
+        auto const uintptr = reinterpret_cast<std::uintptr_t> (p);
+        assert (uintptr != 0U && (uintptr & compilationref_mask) == 0U);
+        return symbol_handle{static_cast<std::uint32_t> ((uintptr >> 1U) - 1U)};
+    }
+
 
     class tagged_pointer {
     public:
-        explicit tagged_pointer (symbol * sym)
+        explicit tagged_pointer (symbol_handle sym)
                 : ptr_{tagged (sym)} {}
         explicit tagged_pointer (compilationref * cr)
                 : ptr_{tagged (cr)} {}
@@ -58,9 +71,8 @@ namespace shadow {
     private:
         void * ptr_;
 
-        static inline void * tagged (symbol * const sym) {
-            assert (as_compilationref (sym) == nullptr);
-            return sym;
+        static inline void * tagged (symbol_handle const sym) {
+            return reinterpret_cast<void *> ((std::uintptr_t{sym.v} + 1U) << 1U);
         }
         static inline void * tagged (compilationref * const cr) {
             assert (as_compilationref (cr) == nullptr);
@@ -69,15 +81,9 @@ namespace shadow {
         }
     };
 
-    using void_ptr = void *;
-    using atomic_void_ptr = std::atomic<void *>;
-
-
-    auto * const busy = reinterpret_cast<void_ptr> (std::numeric_limits<uintptr_t>::max ());
-
     namespace details {
 
-        /// Performs a nullptr -> busy -> symbol*/compilationref* state transition.
+        /// Performs a nullptr -> busy -> symbol/compilationref* state transition.
         ///
         /// \tparam Create  A function with signature tagged_pointer().
         /// \param p  A pointer to the atomic to be set. This should lie within the repository
@@ -90,13 +96,13 @@ namespace shadow {
             if (p->compare_exchange_strong (expected, busy, std::memory_order_acq_rel,
                                             std::memory_order_relaxed)) {
                 expected = create ().as_void_pointer ();
-                p->store (expected, std::memory_order_release);
+                release (p, expected);
                 return true;
             }
             return false;
         }
 
-        /// Performs a compilationref* -> busy -> symbol*/compilationref* state transition.
+        /// Performs a compilationref* -> busy -> symbol/compilationref* state transition.
         ///
         /// \tparam CreateFromCompilationRef  A function with signature
         ///   tagged_pointer(std::atomic<void*>*, compilationref *).
@@ -118,18 +124,19 @@ namespace shadow {
             if (p->compare_exchange_weak (expected, busy, std::memory_order_acq_rel,
                                           std::memory_order_relaxed)) {
                 expected = create_from_compilation_ref (p, cr).as_void_pointer ();
-                p->store (expected, std::memory_order_release);
+                release (p, expected);
                 return true;
             }
             return false;
         }
 
-        /// Performs a symbol* -> busy -> symbol* state transition.
+        /// Performs a symbol -> busy -> symbol state transition.
         ///
-        /// \tparam Update  A function with signature tagged_pointer(std::atomic<void*>*, symbol*).
+        /// \tparam Update  A function with signature
+        ///   tagged_pointer(std::atomic<void*>*, symbol_handle).
         /// \param p  A pointer to the atomic to be set. This should lie within the repository
         ///   shadow memory area.
-        /// \param [in,out] expected  On entry, must point to a symbol pointer.
+        /// \param [in,out] expected  On entry, must record a symbol.
         /// \param update  A function used to update the symbol to which \p expected points. This
         ///   function may adjust the body of the symbol or point it to a different symbol instance
         ///   altogether.
@@ -142,33 +149,23 @@ namespace shadow {
         inline bool symbol_to_final (atomic_void_ptr * const p, void_ptr & expected,
                                      Update const update) {
             assert (as_compilationref (expected) == nullptr);
-            symbol * const sym = reinterpret_cast<symbol *> (expected);
+            symbol_handle const sym = as_symbol (expected);
             if (p->compare_exchange_weak (expected, busy, std::memory_order_acq_rel,
                                           std::memory_order_relaxed)) {
                 expected = update (p, sym).as_void_pointer ();
-                p->store (expected, std::memory_order_release);
+                release (p, expected);
                 return true;
             }
             return false;
         }
 
-        /// \param p  A pointer to the atomic to be set. This should lie within the repository
-        ///   shadow memory area.
-        /// \returns The value contained within the atomic.
-        inline void * spin_while_busy (atomic_void_ptr * const p) {
-            void * expected = busy;
-            while ((expected = p->load (std::memory_order_acquire)) == busy) {
-                std::this_thread::yield ();
-            }
-            return expected;
-        }
-
     } // end namespace details
 
     /// \tparam Create  A function with signature tagged_pointer().
     /// \tparam CreateFromCompilationRef  A function with signature
     ///   tagged_pointer(std::atomic<void*>*, compilationref *).
-    /// \tparam Update A function with signature tagged_pointer(std::atomic<void*>*, symbol*).
+    /// \tparam Update A function with signature
+    ///   tagged_pointer(std::atomic<void*>*, symbol_handle).
     ///
     /// \param p  A pointer to the atomic to be set. This should lie within the repository shadow
     ///   memory area.
@@ -182,22 +179,22 @@ namespace shadow {
     template <typename Create, typename CreateFromCompilationRef, typename Update>
     void set (atomic_void_ptr * const p, Create const create,
               CreateFromCompilationRef const create_from_compilation_ref, Update const update) {
-        // null -> busy -> symbol*/compilationref*
+        // null -> busy -> symbol/compilationref*
         void * expected = nullptr;
         if (details::null_to_final (p, expected, create)) {
             return;
         }
         for (;;) {
             if (expected == busy) {
-                expected = details::spin_while_busy (p);
+                expected = details::wait_while_busy (p);
             }
             if (as_compilationref (expected) != nullptr) {
-                // compilationref* -> busy -> symbol*/compilationref*
+                // compilationref* -> busy -> symbol/compilationref*
                 if (details::compilationref_to_final (p, expected, create_from_compilation_ref)) {
                     return;
                 }
             } else {
-                // symbol* -> busy -> symbol*
+                // symbol -> busy -> symbol
                 if (details::symbol_to_final (p, expected, update)) {
                     return;
                 }
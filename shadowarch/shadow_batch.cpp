@@ -0,0 +1,36 @@
+#include "shadow_batch.hpp"
+
+#include <array>
+#include <limits>
+
+void shadow::batch::sort () {
+    // Below this size, std::sort() is quicker than the radix sort's passes over its counts.
+    constexpr auto radix_threshold = std::size_t{256};
+    constexpr auto digit_bits = 11U;
+    constexpr auto digit_mask = (std::uintptr_t{1} << digit_bits) - 1U;
+
+    auto const first = std::begin (entries_);
+    auto const last = std::end (entries_);
+    if (entries_.size () < radix_threshold) {
+        std::sort (first, last);
+    } else {
+        auto const max = *std::max_element (first, last);
+        scratch_.resize (entries_.size ());
+        // uintptr_t may be narrower than 64 bits: shifting by its width or more is undefined.
+        constexpr auto entry_bits = unsigned{std::numeric_limits<std::uintptr_t>::digits};
+        for (auto shift = 0U; shift < entry_bits && (max >> shift) != 0U; shift += digit_bits) {
+            std::array<std::size_t, digit_mask + 2U> counts{};
+            for (std::uintptr_t const e : entries_) {
+                ++counts[((e >> shift) & digit_mask) + 1U];
+            }
+            for (auto ctr = std::size_t{1}; ctr < counts.size (); ++ctr) {
+                counts[ctr] += counts[ctr - 1U];
+            }
+            for (std::uintptr_t const e : entries_) {
+                scratch_[counts[(e >> shift) & digit_mask]++] = e;
+            }
+            entries_.swap (scratch_);
+        }
+    }
+    entries_.erase (std::unique (std::begin (entries_), std::end (entries_)), std::end (entries_));
+}
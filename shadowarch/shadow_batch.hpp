@@ -0,0 +1,96 @@
+#ifndef SHADOW_BATCH_HPP
+#define SHADOW_BATCH_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "busy_wait.hpp"
+#include "repo.hpp"
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+namespace shadow {
+
+    /// Hints that the shadow pointer \p p is about to be updated.
+    inline void prefetch (atomic_void_ptr const * const p) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch (p, 1 /*write*/, 3 /*high temporal locality*/);
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+        _mm_prefetch (reinterpret_cast<char const *> (p), _MM_HINT_T0);
+#else
+        (void)p;
+#endif
+    }
+
+    /// Collects the names whose shadow pointers are to be updated so that the updates can be
+    /// applied in address order rather than in the order in which the repository lists them. The
+    /// shadow pointers are then visited in a single forward sweep and the pointer which is a
+    /// fixed distance ahead in the sweep is prefetched while the current one is updated.
+    ///
+    /// Each name carries a one-bit tag. Names are aligned, so the tag is kept in the LSB of the
+    /// address and a name with tag 0 sorts immediately before the same name with tag 1.
+    class batch {
+    public:
+        /// The default number of entries between the one being updated and the one being
+        /// prefetched.
+        static constexpr std::size_t default_prefetch_distance = 16U;
+
+        /// \param prefetch_distance  The number of entries between the one being updated and the
+        ///   one being prefetched or 0 to disable prefetching.
+        explicit batch (std::size_t const prefetch_distance = default_prefetch_distance) noexcept
+                : prefetch_distance_{prefetch_distance} {}
+
+        void clear () noexcept { entries_.clear (); }
+        std::size_t size () const noexcept { return entries_.size (); }
+
+        void add (address const name, bool const tag) {
+            assert ((name.raw () & 1U) == 0U);
+            entries_.push_back (name.raw () | std::uintptr_t{tag});
+        }
+
+        /// Sorts the batch by address, removes duplicate entries, and calls \p function
+        /// (address, bool tag) for each entry in order.
+        ///
+        /// \param pointer  A function with signature atomic_void_ptr*(address) which returns the
+        ///   shadow pointer for a name.
+        template <typename Pointer, typename Function>
+        void apply (Pointer const pointer, Function const function) {
+            this->sort ();
+            auto const size = entries_.size ();
+            auto const distance = prefetch_distance_;
+            if (distance > 0U) {
+                for (auto ctr = std::size_t{0}; ctr < std::min (distance, size); ++ctr) {
+                    prefetch (pointer (name (entries_[ctr])));
+                }
+            }
+            for (auto ctr = std::size_t{0}; ctr < size; ++ctr) {
+                if (distance > 0U && ctr + distance < size) {
+                    prefetch (pointer (name (entries_[ctr + distance])));
+                }
+                function (name (entries_[ctr]), (entries_[ctr] & 1U) != 0U);
+            }
+        }
+
+    private:
+        static constexpr address name (std::uintptr_t const entry) noexcept {
+            return address{entry & ~std::uintptr_t{1}};
+        }
+
+        /// Sorts the entries and removes duplicates. Large batches use an LSD radix sort which
+        /// examines only as many bits as the largest address needs.
+        void sort ();
+
+        std::size_t prefetch_distance_;
+        std::vector<std::uintptr_t> entries_;
+        /// The radix sort's scratch buffer.
+        std::vector<std::uintptr_t> scratch_;
+    };
+
+} // end namespace shadow
+
+#endif // SHADOW_BATCH_HPP
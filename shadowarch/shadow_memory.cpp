@@ -0,0 +1,99 @@
+#include "shadow_memory.hpp"
+
+#include <algorithm>
+#include <new>
+
+#if defined(_WIN32)
+#    define NOMINMAX
+#    include <Windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#    include <sys/mman.h>
+#    define SHADOW_MEMORY_HAVE_MMAP 1
+#endif
+
+auto shadow_memory::default_backend () noexcept -> backend {
+#if defined(SHADOW_MEMORY_HAVE_MMAP) || defined(_WIN32)
+    return backend::mmap;
+#else
+    return backend::vector;
+#endif
+}
+
+auto shadow_memory::parse_backend (std::string const & name) -> std::optional<backend> {
+    if (name == "vector") {
+        return backend::vector;
+    }
+    if (name == "mmap") {
+        return backend::mmap;
+    }
+    if (name == "huge") {
+        return backend::mmap_huge;
+    }
+    return std::nullopt;
+}
+
+shadow_memory::shadow_memory (std::size_t const size, backend const kind)
+        : kind_{kind}
+        , size_{size} {
+    // Never map an empty region: mmap() rejects a length of 0.
+    auto const bytes = std::max (size, sizeof (void *));
+    switch (kind) {
+    case backend::vector:
+        vector_.resize (bytes);
+        data_ = vector_.data ();
+        break;
+    case backend::mmap:
+    case backend::mmap_huge:
+#if defined(SHADOW_MEMORY_HAVE_MMAP)
+    {
+        auto flags = MAP_PRIVATE | MAP_ANON;
+#    ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#    endif
+        void * const p = ::mmap (nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc ();
+        }
+#    ifdef MADV_HUGEPAGE
+        if (kind == backend::mmap_huge) {
+            // This is only advice: failure leaves us with ordinary pages.
+            (void) ::madvise (p, bytes, MADV_HUGEPAGE);
+        }
+#    endif
+        data_ = static_cast<std::uint8_t *> (p);
+    }
+#elif defined(_WIN32)
+        // Committed pages are zero-filled by the system on first access.
+        data_ = static_cast<std::uint8_t *> (
+            ::VirtualAlloc (nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+        if (data_ == nullptr) {
+            throw std::bad_alloc ();
+        }
+#else
+        kind_ = backend::vector;
+        vector_.resize (bytes);
+        data_ = vector_.data ();
+#endif
+        break;
+    }
+}
+
+shadow_memory::~shadow_memory () noexcept {
+    if (kind_ == backend::vector) {
+        return;
+    }
+#if defined(SHADOW_MEMORY_HAVE_MMAP)
+    ::munmap (data_, std::max (size_, sizeof (void *)));
+#elif defined(_WIN32)
+    ::VirtualFree (data_, 0, MEM_RELEASE);
+#endif
+}
+
+std::ostream & operator<< (std::ostream & os, shadow_memory::backend const kind) {
+    switch (kind) {
+    case shadow_memory::backend::vector: return os << "vector";
+    case shadow_memory::backend::mmap: return os << "mmap";
+    case shadow_memory::backend::mmap_huge: return os << "huge";
+    }
+    return os;
+}
@@ -0,0 +1,50 @@
+#ifndef SHADOW_MEMORY_HPP
+#define SHADOW_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// The block of zero-initialized memory which shadows the repository's address space.
+class shadow_memory {
+public:
+    enum class backend {
+        /// A std::vector<> which zero-fills the entire region up front.
+        vector,
+        /// Anonymous virtual memory: the kernel supplies zero pages on first touch.
+        mmap,
+        /// As mmap, but additionally asks for transparent huge pages to reduce TLB misses.
+        mmap_huge,
+    };
+
+    /// The fastest backend supported by the host.
+    static backend default_backend () noexcept;
+    /// Converts a backend name ("vector", "mmap", or "huge") to the corresponding enumerator.
+    static std::optional<backend> parse_backend (std::string const & name);
+
+    shadow_memory (std::size_t size, backend kind);
+    shadow_memory (shadow_memory const &) = delete;
+    shadow_memory (shadow_memory &&) = delete;
+    ~shadow_memory () noexcept;
+
+    shadow_memory & operator= (shadow_memory const &) = delete;
+    shadow_memory & operator= (shadow_memory &&) = delete;
+
+    std::uint8_t * data () noexcept { return data_; }
+    std::uint8_t const * data () const noexcept { return data_; }
+    std::size_t size () const noexcept { return size_; }
+    backend kind () const noexcept { return kind_; }
+
+private:
+    backend kind_;
+    std::size_t size_;
+    std::vector<std::uint8_t> vector_;
+    std::uint8_t * data_ = nullptr;
+};
+
+std::ostream & operator<< (std::ostream & os, shadow_memory::backend kind);
+
+#endif // SHADOW_MEMORY_HPP
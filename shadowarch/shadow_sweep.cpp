@@ -0,0 +1,245 @@
+#include "shadow_sweep.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "compilationref.hpp"
+#include "shadow.hpp"
+#include "shadow_memory.hpp"
+#include "task_pool.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define SHADOW_SWEEP_X86 1
+#    include <immintrin.h>
+#endif
+#if defined(SHADOW_SWEEP_X86) && (defined(__GNUC__) || defined(__clang__))
+#    define SHADOW_SWEEP_HAVE_AVX2 1
+#    define SHADOW_SWEEP_AVX2_TARGET __attribute__ ((target ("avx2")))
+#elif defined(SHADOW_SWEEP_X86) && defined(__AVX2__)
+#    define SHADOW_SWEEP_HAVE_AVX2 1
+#    define SHADOW_SWEEP_AVX2_TARGET
+#endif
+
+namespace {
+
+    using word = std::uintptr_t;
+    constexpr auto busy_word = std::numeric_limits<word>::max ();
+    /// The number of pointers in a cache line. A line of null pointers is skipped with a single
+    /// test.
+    constexpr auto line_words = std::size_t{8};
+
+    /// Appends to a sweep_result. \p index is the index of a pointer in the shadow memory region.
+    class appender {
+    public:
+        explicit appender (shadow::sweep_result & result) noexcept
+                : result_{result} {}
+
+        void nulls (std::size_t const count) noexcept { result_.nulls += count; }
+
+        void classify (word const w, std::size_t const index) {
+            if (w == 0U) {
+                ++result_.nulls;
+            } else if (w == busy_word) {
+                result_.busy.push_back (name (index));
+            } else if (w & shadow::compilationref_mask) {
+                result_.compilationrefs.push_back (name (index));
+            } else {
+                result_.symbols.push_back (name (index));
+            }
+        }
+
+        /// Appends the pointers of a vector of \p lanes pointers starting at \p index given a mask
+        /// of each kind. Bit n of a mask describes the pointer at index + n.
+        void classify (unsigned const lanes, unsigned const busy, unsigned const compilationrefs,
+                       unsigned const symbols, std::size_t const index) {
+            result_.nulls += lanes - popcount (busy | compilationrefs | symbols);
+            append (result_.busy, busy, index);
+            append (result_.compilationrefs, compilationrefs, index);
+            append (result_.symbols, symbols, index);
+        }
+
+    private:
+        static constexpr address name (std::size_t const index) noexcept {
+            return address{index * sizeof (word)};
+        }
+        static unsigned popcount (unsigned mask) noexcept {
+            auto result = 0U;
+            for (; mask != 0U; mask &= mask - 1U) {
+                ++result;
+            }
+            return result;
+        }
+        static void append (std::vector<address> & names, unsigned mask, std::size_t const index) {
+            for (auto lane = std::size_t{0}; mask != 0U; ++lane, mask >>= 1U) {
+                if (mask & 1U) {
+                    names.push_back (name (index + lane));
+                }
+            }
+        }
+
+        shadow::sweep_result & result_;
+    };
+
+    void sweep_scalar (word const * const words, std::size_t const first, std::size_t const last,
+                       appender & out) {
+        for (auto index = first; index < last; ++index) {
+            out.classify (words[index], index);
+        }
+    }
+
+#if defined(SHADOW_SWEEP_X86)
+    void sweep_sse2 (word const * const words, std::size_t const first, std::size_t const last,
+                     appender & out) {
+        auto index = first;
+        __m128i const zero = _mm_setzero_si128 ();
+        for (; index + line_words <= last; index += line_words) {
+            auto const * const p = reinterpret_cast<__m128i const *> (words + index);
+            __m128i const line =
+                _mm_or_si128 (_mm_or_si128 (_mm_loadu_si128 (p), _mm_loadu_si128 (p + 1)),
+                              _mm_or_si128 (_mm_loadu_si128 (p + 2), _mm_loadu_si128 (p + 3)));
+            if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (line, zero)) == 0xFFFF) {
+                out.nulls (line_words);
+                continue;
+            }
+            // SSE2 has no 64-bit comparison: classify the line one pointer at a time.
+            sweep_scalar (words, index, index + line_words, out);
+        }
+        sweep_scalar (words, index, last, out);
+    }
+#endif // SHADOW_SWEEP_X86
+
+#if defined(SHADOW_SWEEP_HAVE_AVX2)
+    /// Gathers the top bit of each 64-bit lane of \p v: bit n of the result is set if lane n is
+    /// all ones.
+    SHADOW_SWEEP_AVX2_TARGET
+    inline unsigned mask (__m256i const v) noexcept {
+        return static_cast<unsigned> (_mm256_movemask_pd (_mm256_castsi256_pd (v)));
+    }
+
+    SHADOW_SWEEP_AVX2_TARGET
+    void sweep_avx2 (word const * const words, std::size_t const first, std::size_t const last,
+                     appender & out) {
+        constexpr auto lanes = 4U;
+        __m256i const zero = _mm256_setzero_si256 ();
+        __m256i const busy = _mm256_set1_epi64x (static_cast<long long> (busy_word));
+        __m256i const tag = _mm256_set1_epi64x (shadow::compilationref_mask);
+
+        auto index = first;
+        for (; index + line_words <= last; index += line_words) {
+            auto const * const p = reinterpret_cast<__m256i const *> (words + index);
+            __m256i const v[2] = {_mm256_loadu_si256 (p), _mm256_loadu_si256 (p + 1)};
+            __m256i const line = _mm256_or_si256 (v[0], v[1]);
+            if (_mm256_testz_si256 (line, line)) {
+                out.nulls (line_words);
+                continue;
+            }
+            for (auto half = 0U; half < 2U; ++half) {
+                auto const nulls = mask (_mm256_cmpeq_epi64 (v[half], zero));
+                auto const busies = mask (_mm256_cmpeq_epi64 (v[half], busy));
+                auto const tagged =
+                    mask (_mm256_cmpeq_epi64 (_mm256_and_si256 (v[half], tag), tag));
+                auto const compilationrefs = tagged & ~busies;
+                auto const symbols = ~(nulls | busies | tagged) & 0xFU;
+                out.classify (lanes, busies, compilationrefs, symbols, index + half * lanes);
+            }
+        }
+        sweep_scalar (words, index, last, out);
+    }
+#endif // SHADOW_SWEEP_HAVE_AVX2
+
+    bool have_avx2 () noexcept {
+#if defined(SHADOW_SWEEP_HAVE_AVX2) && (defined(__GNUC__) || defined(__clang__))
+        return __builtin_cpu_supports ("avx2");
+#elif defined(SHADOW_SWEEP_HAVE_AVX2)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void sweep_range (shadow::sweep_isa const isa, word const * const words,
+                      std::size_t const first, std::size_t const last,
+                      shadow::sweep_result & result) {
+        appender out{result};
+        switch (isa) {
+#if defined(SHADOW_SWEEP_HAVE_AVX2)
+        case shadow::sweep_isa::avx2: sweep_avx2 (words, first, last, out); return;
+#endif
+#if defined(SHADOW_SWEEP_X86)
+        case shadow::sweep_isa::sse2: sweep_sse2 (words, first, last, out); return;
+#endif
+        default: sweep_scalar (words, first, last, out); return;
+        }
+    }
+
+} // end anonymous namespace
+
+namespace shadow {
+
+    sweep_isa best_sweep_isa () noexcept {
+        if (have_avx2 ()) {
+            return sweep_isa::avx2;
+        }
+#if defined(SHADOW_SWEEP_X86)
+        return sweep_isa::sse2;
+#else
+        return sweep_isa::scalar;
+#endif
+    }
+
+    std::optional<sweep_isa> parse_sweep_isa (std::string const & name) {
+        if (name == "scalar") {
+            return sweep_isa::scalar;
+        }
+#if defined(SHADOW_SWEEP_X86)
+        if (name == "sse2") {
+            return sweep_isa::sse2;
+        }
+#endif
+        if (name == "avx2" && have_avx2 ()) {
+            return sweep_isa::avx2;
+        }
+        return std::nullopt;
+    }
+
+    char const * to_string (sweep_isa const isa) noexcept {
+        switch (isa) {
+        case sweep_isa::scalar: return "scalar";
+        case sweep_isa::sse2: return "sse2";
+        case sweep_isa::avx2: return "avx2";
+        }
+        return "unknown";
+    }
+
+    sweep_result sweep (shadow_memory const & shadow, task_pool & pool, sweep_isa const isa) {
+        // The number of pointers swept by each task (8MiB of shadow memory).
+        constexpr auto chunk_words = std::size_t{1} << 20U;
+
+        auto const * const words = reinterpret_cast<word const *> (shadow.data ());
+        auto const size = shadow.size () / sizeof (word);
+        std::vector<sweep_result> chunks ((size + chunk_words - 1U) / chunk_words);
+        task_group tasks;
+        for (auto c = std::size_t{0}; c < chunks.size (); ++c) {
+            pool.submit (tasks, [isa, words, size, c, &chunks] {
+                auto const first = c * chunk_words;
+                sweep_range (isa, words, first, std::min (first + chunk_words, size), chunks[c]);
+            });
+        }
+        tasks.wait ();
+
+        // Concatenate the chunks' lists: they remain in address order.
+        sweep_result result;
+        auto const join = [] (std::vector<address> & to, std::vector<address> const & from) {
+            to.insert (std::end (to), std::begin (from), std::end (from));
+        };
+        for (sweep_result const & chunk : chunks) {
+            result.nulls += chunk.nulls;
+            join (result.symbols, chunk.symbols);
+            join (result.compilationrefs, chunk.compilationrefs);
+            join (result.busy, chunk.busy);
+        }
+        return result;
+    }
+
+} // end namespace shadow
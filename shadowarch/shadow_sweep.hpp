@@ -0,0 +1,51 @@
+#ifndef SHADOW_SWEEP_HPP
+#define SHADOW_SWEEP_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "repo.hpp"
+
+class shadow_memory;
+class task_pool;
+
+namespace shadow {
+
+    /// The instruction set used to classify shadow pointers.
+    enum class sweep_isa {
+        /// One pointer at a time.
+        scalar,
+        /// A cache line of null pointers is skipped with a single test; other lines are classified
+        /// one pointer at a time.
+        sse2,
+        /// Four pointers per instruction.
+        avx2,
+    };
+
+    /// The fastest instruction set supported by the host.
+    sweep_isa best_sweep_isa () noexcept;
+    /// Converts an instruction set name ("scalar", "sse2", or "avx2") to the corresponding
+    /// enumerator. Returns no value if the name is unknown or the host does not support it.
+    std::optional<sweep_isa> parse_sweep_isa (std::string const & name);
+    char const * to_string (sweep_isa isa) noexcept;
+
+    /// The shadow pointers of a region grouped by state. The lists hold the addresses shadowed by
+    /// the pointers in ascending order.
+    struct sweep_result {
+        std::size_t nulls = 0U;
+        std::vector<address> symbols;
+        std::vector<address> compilationrefs;
+        std::vector<address> busy;
+    };
+
+    /// Classifies every pointer in the shadow memory region. The region is split into chunks
+    /// which are swept concurrently by the pool's workers. Nothing may modify the shadow memory
+    /// while the sweep is running.
+    sweep_result sweep (shadow_memory const & shadow, task_pool & pool,
+                        sweep_isa isa = best_sweep_isa ());
+
+} // end namespace shadow
+
+#endif // SHADOW_SWEEP_HPP
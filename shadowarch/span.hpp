@@ -0,0 +1,33 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <cassert>
+#include <cstddef>
+
+/// A minimal stand-in for C++20's std::span<>: a non-owning view of a contiguous sequence.
+template <typename T>
+class span {
+public:
+    constexpr span () noexcept = default;
+    constexpr span (T * const first, std::size_t const size) noexcept
+            : first_{first}
+            , size_{size} {}
+
+    constexpr T * data () const noexcept { return first_; }
+    constexpr std::size_t size () const noexcept { return size_; }
+    constexpr bool empty () const noexcept { return size_ == 0U; }
+
+    constexpr T * begin () const noexcept { return first_; }
+    constexpr T * end () const noexcept { return first_ + size_; }
+
+    constexpr T & operator[] (std::size_t const index) const noexcept {
+        assert (index < size_);
+        return first_[index];
+    }
+
+private:
+    T * first_ = nullptr;
+    std::size_t size_ = 0U;
+};
+
+#endif // SPAN_HPP
@@ -3,16 +3,13 @@
 #include "context.hpp"
 
 // create a defined symbol.
-symbol * new_symbol (context & context, address const name, unsigned const ordinal) {
-    std::lock_guard<std::mutex> _{context.symbols_mutex};
-    context.symbols.emplace_back (name, ordinal);
-    return &context.symbols.back ();
+symbol_handle new_symbol (context & context, address const name, unsigned const ordinal) {
+    return context.symbols.make (name, ordinal);
 }
 
 // create an undef symbol.
-symbol * new_symbol (context & context, address const name) {
-    std::lock_guard<std::mutex> _{context.symbols_mutex};
-    context.symbols.emplace_back (name);
+symbol_handle new_symbol (context & context, address const name) {
+    symbol_handle const sym = context.symbols.make (name);
     context.undefs.add (name);
-    return &context.symbols.back ();
+    return sym;
 }
@@ -1,109 +1,175 @@
 #ifndef SYMBOL_HPP
 #define SYMBOL_HPP
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
-#include <optional>
+#include <cstdint>
+#include <limits>
 #include <mutex>
 #include <unordered_set>
-#include <type_traits>
+#include <vector>
 
+#include "concurrent_array.hpp"
 #include "repo.hpp"
 
-template <typename T>
-struct remove_cvref {
-    typedef std::remove_cv_t<std::remove_reference_t<T>> type;
-};
-template <typename T>
-using remove_cvref_t = typename remove_cvref<T>::type;
-
-template <typename LockType>
-struct is_lock_type : public std::false_type {};
-template <>
-struct is_lock_type<std::lock_guard<std::mutex>> : public std::true_type {};
-template <>
-struct is_lock_type<std::unique_lock<std::mutex>> : public std::true_type {};
-
-template <typename T>
-inline constexpr bool is_lock_type_v = is_lock_type<T>::value;
+struct context;
 
+/// A 32-bit index which identifies a symbol within the symbol table.
+struct symbol_handle {
+    constexpr bool operator== (symbol_handle const rhs) const noexcept { return v == rhs.v; }
+    constexpr bool operator!= (symbol_handle const rhs) const noexcept { return !operator== (rhs); }
 
-struct context;
+    std::uint32_t v;
+};
 
-class symbol {
+/// The symbol table holds each symbol's name and ordinal in separate arrays (a
+/// structure-of-arrays) indexed by symbol_handle. A symbol is undefined until it is given an
+/// ordinal. Symbols are created and their ordinals set with single atomic operations; no locks
+/// are involved.
+///
+/// Note that the transition from undef to def needs no further synchronization because a
+/// symbol is only reachable through its shadow memory pointer: the "busy" state of that pointer
+/// already guarantees that only one thread at a time can be updating it.
+class symbol_table {
 public:
-    // Create an undef symbol.
-    explicit symbol (address const name)
-            : name_{name}
-            , ordinal_{std::nullopt} {}
-    // Create a defined symbol.
-    symbol (address const name, unsigned const ordinal)
-            : name_{name}
-            , ordinal_{ordinal} {}
-
-    void set_ordinal (unsigned ordinal) {
-        std::lock_guard<std::mutex> _{mutex_};
-        assert (!this->ordinal_.has_value ());
-        this->ordinal_ = ordinal;
+    /// Creates a defined symbol.
+    symbol_handle make (address const name, unsigned const ordinal) {
+        assert (ordinal != undef_ordinal);
+        symbol_handle const sym = this->allocate ();
+        names_[sym.v] = name;
+        ordinals_[sym.v].store (ordinal, std::memory_order_relaxed);
+        return sym;
+    }
+    /// Creates an undefined symbol.
+    symbol_handle make (address const name) {
+        symbol_handle const sym = this->allocate ();
+        names_[sym.v] = name;
+        ordinals_[sym.v].store (undef_ordinal, std::memory_order_relaxed);
+        return sym;
     }
 
-    template <typename LockType,
-              typename = typename std::enable_if_t<is_lock_type_v<remove_cvref_t<LockType>>>>
-    bool is_def (LockType &&) const noexcept {
-        return this->ordinal_.has_value ();
+    /// Turns an undefined symbol into a defined symbol.
+    void set_ordinal (symbol_handle const sym, unsigned const ordinal) {
+        assert (ordinal != undef_ordinal);
+        [[maybe_unused]] auto expected = undef_ordinal;
+        [[maybe_unused]] bool const ok = ordinals_[sym.v].compare_exchange_strong (
+            expected, ordinal, std::memory_order_acq_rel, std::memory_order_relaxed);
+        assert (ok && "Symbol was already defined");
     }
-    bool is_def () const noexcept { return this->is_def (std::lock_guard<std::mutex>{mutex_}); }
 
-    constexpr address name () const noexcept { return name_; }
-    std::unique_lock<std::mutex> take_lock () { return std::unique_lock<std::mutex>{mutex_}; }
+    bool is_def (symbol_handle const sym) const noexcept {
+        return ordinals_[sym.v].load (std::memory_order_acquire) != undef_ordinal;
+    }
+    address name (symbol_handle const sym) const noexcept { return names_[sym.v]; }
+
+    /// The number of symbols in the table.
+    std::uint32_t size () const noexcept { return size_.load (std::memory_order_relaxed); }
+    /// The number of bytes allocated to hold the table's columns.
+    std::size_t bytes_allocated () const noexcept {
+        return names_.bytes_allocated () + ordinals_.bytes_allocated ();
+    }
 
 private:
-    mutable std::mutex mutex_;
-    address const name_;
-    std::optional<unsigned> ordinal_;
+    static constexpr auto undef_ordinal = std::numeric_limits<unsigned>::max ();
+
+    symbol_handle allocate () {
+        auto const index = size_.fetch_add (1U, std::memory_order_relaxed);
+        assert (index < std::numeric_limits<std::uint32_t>::max () && "Too many symbols");
+        return symbol_handle{index};
+    }
+
+    std::atomic<std::uint32_t> size_{0};
+    concurrent_array<address> names_;
+    concurrent_array<std::atomic<unsigned>> ordinals_;
 };
 
 
 // create a defined symbol.
-symbol * new_symbol (context & context, address const name, unsigned const ordinal);
+symbol_handle new_symbol (context & context, address const name, unsigned const ordinal);
 // create an undef symbol.
-symbol * new_symbol (context & context, address const name);
+symbol_handle new_symbol (context & context, address const name);
 
 
 
+/// The collection of names which are currently undefined. The set is split into shards, each
+/// guarded by its own mutex, so that threads working on unrelated names rarely contend. A
+/// separate atomic count of the live undefs means that empty() is a single load.
 class undefined_symbols {
 public:
-    void erase (address const d) {
-        std::lock_guard<std::mutex> _{mutex_};
-        assert (undefs_.find (d) != undefs_.end ());
-        undefs_.erase (d);
+    /// Removes \p d from the collection if present.
+    /// \returns True if \p d was removed.
+    bool erase (address const d) {
+        shard & s = this->shard_for (d);
+        std::lock_guard<std::mutex> _{s.mutex};
+        if (s.undefs.erase (d) == 0U) {
+            return false;
+        }
+        count_.fetch_sub (1U, std::memory_order_release);
+        return true;
     }
 
-    void add (address const d) {
-        std::lock_guard<std::mutex> _{mutex_};
-        undefs_.insert (d);
+    /// Adds \p d to the collection.
+    /// \returns True if \p d was not already present.
+    bool add (address const d) {
+        shard & s = this->shard_for (d);
+        std::lock_guard<std::mutex> _{s.mutex};
+        if (!s.undefs.insert (d).second) {
+            return false;
+        }
+        count_.fetch_add (1U, std::memory_order_release);
+        return true;
     }
 
     bool has (address const d) const {
-        std::lock_guard<std::mutex> _{mutex_};
-        return undefs_.count (d) > 0U;
+        shard const & s = this->shard_for (d);
+        std::lock_guard<std::mutex> _{s.mutex};
+        return s.undefs.count (d) > 0U;
     }
 
-    bool empty () const {
-        std::lock_guard<std::mutex> _{mutex_};
-        return undefs_.empty ();
-    }
+    bool empty () const noexcept { return this->size () == 0U; }
+    std::size_t size () const noexcept { return count_.load (std::memory_order_acquire); }
 
+    /// Calls \p function (address) for each undefined name in an unspecified order.
     template <typename Function>
     void for_each (Function function) {
-        std::lock_guard<std::mutex> _{mutex_};
-        for (auto const & d : undefs_) {
-            function (d);
+        for (shard & s : shards_) {
+            std::lock_guard<std::mutex> _{s.mutex};
+            for (auto const & d : s.undefs) {
+                function (d);
+            }
         }
     }
 
+    /// Calls \p function (address) for each undefined name in the order given by \p less.
+    template <typename Less, typename Function>
+    void for_each_sorted (Less less, Function function) {
+        std::vector<address> names;
+        names.reserve (this->size ());
+        this->for_each ([&names] (address const d) { names.push_back (d); });
+        std::sort (std::begin (names), std::end (names), less);
+        std::for_each (std::begin (names), std::end (names), function);
+    }
+
 private:
-    mutable std::mutex mutex_;
-    std::unordered_set<address> undefs_;
+    static constexpr auto shard_bits = 6U;
+
+    struct alignas (64) shard {
+        mutable std::mutex mutex;
+        std::unordered_set<address> undefs;
+    };
+
+    static std::size_t shard_index (address const d) noexcept {
+        // Fibonacci hashing: take the top bits of the product with 2^64/phi.
+        return static_cast<std::size_t> ((std::uint64_t{d.raw ()} * 0x9E3779B97F4A7C15ULL) >>
+                                         (64U - shard_bits));
+    }
+    shard & shard_for (address const d) noexcept { return shards_[shard_index (d)]; }
+    shard const & shard_for (address const d) const noexcept { return shards_[shard_index (d)]; }
+
+    std::array<shard, std::size_t{1} << shard_bits> shards_;
+    std::atomic<std::size_t> count_{0};
 };
 
 
@@ -0,0 +1,123 @@
+#include "task_pool.hpp"
+
+#include <string>
+
+#include "timeline.hpp"
+
+namespace {
+
+    /// The pool (if any) to which the current thread belongs and its index within that pool.
+    thread_local task_pool const * current_pool = nullptr;
+    thread_local unsigned current_index = 0U;
+
+} // end anonymous namespace
+
+void task_group::wait () {
+    std::unique_lock<std::mutex> lock{mutex_};
+    cv_.wait (lock, [this] { return outstanding_.load (std::memory_order_acquire) == 0U; });
+}
+
+void task_group::task_completed () {
+    // The count is decremented under the mutex. Were it decremented first, wait() could see zero
+    // and return, and the group be destroyed, before this thread locked the mutex to notify.
+    std::lock_guard<std::mutex> _{mutex_};
+    if (outstanding_.fetch_sub (1U, std::memory_order_acq_rel) == 1U) {
+        cv_.notify_all ();
+    }
+}
+
+task_pool::task_pool (unsigned const workers) {
+    auto const count = std::max (workers, 1U);
+    queues_.reserve (count);
+    for (auto index = 0U; index < count; ++index) {
+        queues_.emplace_back (std::make_unique<worker_queue> ());
+    }
+    threads_.reserve (count);
+    for (auto index = 0U; index < count; ++index) {
+        threads_.emplace_back (&task_pool::worker, this, index);
+    }
+}
+
+task_pool::~task_pool () noexcept {
+    stop_.store (true, std::memory_order_seq_cst);
+    {
+        std::lock_guard<std::mutex> _{sleep_mutex_};
+        sleep_cv_.notify_all ();
+    }
+    for (auto & t : threads_) {
+        t.join ();
+    }
+}
+
+void task_pool::submit (task_group & group, task t) {
+    group.add ();
+    auto const index = current_pool == this
+                           ? current_index
+                           : next_queue_.fetch_add (1U, std::memory_order_relaxed) % size ();
+    {
+        worker_queue & q = *queues_[index];
+        std::lock_guard<std::mutex> _{q.mutex};
+        q.tasks.push_back (queued_task{&group, std::move (t)});
+    }
+    pending_.fetch_add (1U, std::memory_order_seq_cst);
+    // A worker increments sleepers_ before checking pending_ for the last time. Either it sees
+    // our task or we see it and wake it.
+    if (sleepers_.load (std::memory_order_seq_cst) > 0U) {
+        std::lock_guard<std::mutex> _{sleep_mutex_};
+        sleep_cv_.notify_one ();
+    }
+}
+
+bool task_pool::pop_or_steal (unsigned const index, queued_task & out) {
+    {
+        worker_queue & own = *queues_[index];
+        std::lock_guard<std::mutex> _{own.mutex};
+        if (!own.tasks.empty ()) {
+            out = std::move (own.tasks.back ());
+            own.tasks.pop_back ();
+            return true;
+        }
+    }
+    auto const n = size ();
+    for (auto offset = 1U; offset < n; ++offset) {
+        worker_queue & victim = *queues_[(index + offset) % n];
+        std::lock_guard<std::mutex> _{victim.mutex};
+        if (!victim.tasks.empty ()) {
+            out = std::move (victim.tasks.front ());
+            victim.tasks.pop_front ();
+            return true;
+        }
+    }
+    return false;
+}
+
+void task_pool::worker (unsigned const index) {
+    current_pool = this;
+    current_index = index;
+    timeline::recorder & recorder = timeline::recorder::get ();
+    if (recorder.enabled ()) {
+        recorder.name_thread ("worker " + std::to_string (index));
+    }
+    for (;;) {
+        queued_task qt;
+        if (this->pop_or_steal (index, qt)) {
+            pending_.fetch_sub (1U, std::memory_order_relaxed);
+            qt.t ();
+            qt.group->task_completed ();
+            continue;
+        }
+
+        timeline::scope const idle{"idle"};
+        std::unique_lock<std::mutex> lock{sleep_mutex_};
+        sleepers_.fetch_add (1U, std::memory_order_seq_cst);
+        sleep_cv_.wait (lock, [this] {
+            return pending_.load (std::memory_order_seq_cst) > 0U ||
+                   stop_.load (std::memory_order_seq_cst);
+        });
+        sleepers_.fetch_sub (1U, std::memory_order_relaxed);
+        if (pending_.load (std::memory_order_relaxed) == 0U &&
+            stop_.load (std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef TASK_POOL_HPP
+#define TASK_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A latch which counts the tasks that have been submitted to it but have not yet completed.
+/// A thread may wait for every task in the group to complete. The group must not be destroyed
+/// until wait() has returned: a completing task may still be using it until then.
+class task_group {
+public:
+    task_group () = default;
+    task_group (task_group const &) = delete;
+    task_group (task_group &&) = delete;
+    ~task_group () noexcept { assert (outstanding_.load (std::memory_order_relaxed) == 0U); }
+
+    task_group & operator= (task_group const &) = delete;
+    task_group & operator= (task_group &&) = delete;
+
+    /// Blocks until every task submitted to this group has completed.
+    void wait ();
+
+private:
+    friend class task_pool;
+
+    void add () noexcept { outstanding_.fetch_add (1U, std::memory_order_relaxed); }
+    void task_completed ();
+
+    std::atomic<std::size_t> outstanding_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+/// A fixed-size pool of worker threads which execute tasks. Each worker has its own deque of
+/// tasks: the owner pushes and pops at the back while idle workers steal from the front of the
+/// other workers' deques.
+class task_pool {
+public:
+    using task = std::function<void ()>;
+
+    /// \param workers  The number of worker threads. Defaults to the hardware concurrency.
+    explicit task_pool (unsigned workers = default_workers ());
+    task_pool (task_pool const &) = delete;
+    task_pool (task_pool &&) = delete;
+    /// Waits for queued tasks to complete and then joins the worker threads.
+    ~task_pool () noexcept;
+
+    task_pool & operator= (task_pool const &) = delete;
+    task_pool & operator= (task_pool &&) = delete;
+
+    /// Queues a task for execution as a member of the given group. If called from one of this
+    /// pool's workers, the task is added to that worker's own deque; otherwise the deques are
+    /// chosen round-robin.
+    void submit (task_group & group, task t);
+
+    /// Returns the number of worker threads.
+    unsigned size () const noexcept { return static_cast<unsigned> (queues_.size ()); }
+
+    static unsigned default_workers () noexcept {
+        return std::max (std::thread::hardware_concurrency (), 1U);
+    }
+
+private:
+    struct queued_task {
+        task_group * group;
+        task t;
+    };
+    struct alignas (64) worker_queue {
+        std::mutex mutex;
+        std::deque<queued_task> tasks;
+    };
+
+    void worker (unsigned index);
+    /// Pops a task from the back of the deque belonging to worker \p index or, if that is empty,
+    /// steals from the front of another worker's deque.
+    bool pop_or_steal (unsigned index, queued_task & out);
+
+    std::vector<std::unique_ptr<worker_queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    /// The number of tasks which have been queued but not yet taken by a worker.
+    std::atomic<std::size_t> pending_{0};
+    /// The number of workers blocked waiting for a task.
+    std::atomic<unsigned> sleepers_{0};
+    std::atomic<unsigned> next_queue_{0};
+    std::atomic<bool> stop_{false};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+};
+
+#endif // TASK_POOL_HPP
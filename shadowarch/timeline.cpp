@@ -0,0 +1,90 @@
+#include "timeline.hpp"
+
+#include <chrono>
+#include <iomanip>
+
+namespace {
+
+    thread_local void * local_buffer = nullptr;
+
+    auto const epoch = std::chrono::steady_clock::now ();
+
+    void write_string (std::ostream & os, std::string const & s) {
+        os << '"';
+        for (char const c : s) {
+            if (c == '"' || c == '\\') {
+                os << '\\';
+            }
+            os << c;
+        }
+        os << '"';
+    }
+
+    /// Writes a time in nanoseconds as the microseconds expected by the trace format.
+    void write_micros (std::ostream & os, std::uint64_t const ns) {
+        os << ns / 1000U << '.' << std::setw (3) << std::setfill ('0') << ns % 1000U
+           << std::setfill (' ');
+    }
+
+} // end anonymous namespace
+
+namespace timeline {
+
+    recorder & recorder::get () noexcept {
+        static recorder r;
+        return r;
+    }
+
+    std::uint64_t recorder::now () noexcept {
+        return static_cast<std::uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (
+                                               std::chrono::steady_clock::now () - epoch)
+                                               .count ());
+    }
+
+    auto recorder::local () -> thread_buffer & {
+        if (local_buffer == nullptr) {
+            std::lock_guard<std::mutex> _{mutex_};
+            buffers_.emplace_back (static_cast<unsigned> (buffers_.size ()));
+            local_buffer = &buffers_.back ();
+        }
+        return *static_cast<thread_buffer *> (local_buffer);
+    }
+
+    void recorder::name_thread (std::string name) {
+        if (this->enabled ()) {
+            this->local ().name = std::move (name);
+        }
+    }
+
+    void recorder::write_chrome_trace (std::ostream & os) const {
+        std::lock_guard<std::mutex> _{mutex_};
+        os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+        auto separator = "\n";
+        for (thread_buffer const & b : buffers_) {
+            if (!b.name.empty ()) {
+                os << separator << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                   << "\"tid\": " << b.tid << ", \"args\": {\"name\": ";
+                write_string (os, b.name);
+                os << "}}";
+                separator = ",\n";
+            }
+            for (event const & e : b.events) {
+                os << separator << "{\"name\": ";
+                write_string (os, e.name);
+                os << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << b.tid << ", \"ts\": ";
+                write_micros (os, e.begin);
+                os << ", \"dur\": ";
+                write_micros (os, e.end - e.begin);
+                if (e.arg_name != nullptr) {
+                    os << ", \"args\": {";
+                    write_string (os, e.arg_name);
+                    os << ": " << e.arg << '}';
+                }
+                os << '}';
+                separator = ",\n";
+            }
+        }
+        os << "\n]}\n";
+    }
+
+} // end namespace timeline
@@ -0,0 +1,94 @@
+#ifndef TIMELINE_HPP
+#define TIMELINE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace timeline {
+
+    /// A completed span of work on one thread.
+    struct event {
+        /// The event's name. Must be a string literal (or otherwise outlive the recorder).
+        char const * name;
+        /// If not null, the name of the event's single numeric argument.
+        char const * arg_name;
+        std::uint64_t arg;
+        /// Begin and end times in nanoseconds (see recorder::now()).
+        std::uint64_t begin;
+        std::uint64_t end;
+    };
+
+    /// Collects events in per-thread buffers so that recording needs no synchronization between
+    /// threads. The events are written as a Chrome trace (viewable in Perfetto or
+    /// chrome://tracing). Recording is disabled by default.
+    class recorder {
+    public:
+        static recorder & get () noexcept;
+
+        bool enabled () const noexcept { return enabled_.load (std::memory_order_relaxed); }
+        void enable (bool const e) noexcept { enabled_.store (e, std::memory_order_relaxed); }
+
+        /// The current time in nanoseconds since the recorder was first used.
+        static std::uint64_t now () noexcept;
+
+        /// Appends an event to the calling thread's buffer.
+        void record (event const & e) { this->local ().events.push_back (e); }
+        /// Sets the name shown for the calling thread. Does nothing if recording is disabled.
+        void name_thread (std::string name);
+
+        /// Writes every recorded event in Chrome's JSON trace event format. No events may be
+        /// recorded while this function is running.
+        void write_chrome_trace (std::ostream & os) const;
+
+    private:
+        struct thread_buffer {
+            explicit thread_buffer (unsigned const tid_)
+                    : tid{tid_} {}
+            unsigned const tid;
+            std::string name;
+            std::vector<event> events;
+        };
+        thread_buffer & local ();
+
+        std::atomic<bool> enabled_{false};
+        mutable std::mutex mutex_;
+        /// The buffers of every thread which has recorded an event. They outlive their threads.
+        std::list<thread_buffer> buffers_;
+    };
+
+    /// Records an event spanning the lifetime of the scope object if the recorder is enabled.
+    class scope {
+    public:
+        explicit scope (char const * const name, char const * const arg_name = nullptr,
+                        std::uint64_t const arg = 0U) noexcept
+                : name_{name}
+                , arg_name_{arg_name}
+                , arg_{arg}
+                , begin_{recorder::get ().enabled () ? recorder::now () : not_recording} {}
+        scope (scope const &) = delete;
+        scope (scope &&) = delete;
+        ~scope () noexcept {
+            if (begin_ != not_recording) {
+                recorder::get ().record (event{name_, arg_name_, arg_, begin_, recorder::now ()});
+            }
+        }
+
+        scope & operator= (scope const &) = delete;
+        scope & operator= (scope &&) = delete;
+
+    private:
+        static constexpr auto not_recording = ~std::uint64_t{0};
+        char const * const name_;
+        char const * const arg_name_;
+        std::uint64_t const arg_;
+        std::uint64_t const begin_;
+    };
+
+} // end namespace timeline
+
+#endif // TIMELINE_HPP
@@ -0,0 +1,19 @@
+#include "CompletionOrder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <random>
+
+std::vector<unsigned> completionOrder (const unsigned Blocks, const unsigned GroupSize) {
+    auto RNG = std::mt19937{Blocks};
+    std::vector<unsigned> Order (std::size_t{Blocks});
+    std::iota (std::begin (Order), std::end (Order), 0U);
+    for (auto First = std::begin (Order); First != std::end (Order);) {
+        const auto Last =
+            First + std::min (std::ptrdiff_t{GroupSize}, std::end (Order) - First);
+        std::shuffle (First, Last, RNG);
+        First = Last;
+    }
+    return Order;
+}
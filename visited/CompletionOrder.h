@@ -0,0 +1,15 @@
+#ifndef COMPLETION_ORDER_HPP
+#define COMPLETION_ORDER_HPP
+
+#include <vector>
+
+/// The default number of consecutive blocks that are shuffled together by completionOrder().
+constexpr auto DefaultCompletionGroupSize = 256U;
+
+/// Returns the order in which blocks of files are completed to simulate out-of-order completion
+/// of the files within each symbol resolution group: the range [0, Blocks) shuffled within each
+/// run of GroupSize blocks. The order depends only on the arguments.
+std::vector<unsigned> completionOrder (unsigned Blocks,
+                                       unsigned GroupSize = DefaultCompletionGroupSize);
+
+#endif // COMPLETION_ORDER_HPP
@@ -0,0 +1,199 @@
+#include "Replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iomanip>
+#include <map>
+#include <numeric>
+#include <thread>
+
+#include "Visited.h"
+
+namespace {
+
+    using Clock = ReplayResult::Clock;
+    using Micros = std::chrono::duration<double, std::micro>;
+    using Millis = std::chrono::duration<double, std::milli>;
+
+    /// Returns the value at the given percentile of the sorted values in \p Sorted.
+    double percentile (const std::vector<double> & Sorted, const double P) {
+        if (Sorted.empty ()) {
+            return 0.0;
+        }
+        const auto Rank =
+            static_cast<std::size_t> (P / 100.0 * static_cast<double> (Sorted.size ()));
+        return Sorted[std::min (Rank, Sorted.size () - 1U)];
+    }
+
+    /// A change in the number of files that have been completed but not yet delivered.
+    struct Event {
+        Clock::time_point When;
+        unsigned Ordinal;
+        bool IsCompletion;
+    };
+
+    std::vector<Event> events (const ReplayResult & R) {
+        std::vector<Event> Events;
+        Events.reserve (R.Completed.size () * 2U);
+        for (auto Ordinal = 0U; Ordinal < R.Completed.size (); ++Ordinal) {
+            Events.push_back (Event{R.Completed[Ordinal], Ordinal, true});
+            Events.push_back (Event{R.Delivered[Ordinal], Ordinal, false});
+        }
+        // A file's completion must precede its delivery even if they share a timestamp.
+        std::sort (std::begin (Events), std::end (Events), [] (const Event & A, const Event & B) {
+            return A.When < B.When || (A.When == B.When && A.IsCompletion && !B.IsCompletion);
+        });
+        return Events;
+    }
+
+    /// Queue depth statistics for one reporting interval.
+    struct Interval {
+        double WeightedDepth = 0.0; ///< The integral of depth over time (depth x microseconds).
+        unsigned MaxDepth = 0U;
+    };
+
+} // end anonymous namespace
+
+// replay
+// ~~~~~~
+ReplayResult replay (const std::vector<TraceRecord> & Trace, const ReplayOptions & Opts) {
+    assert (Opts.Producers > 0U && Opts.Speed > 0.0);
+    // The order in which the files are completed. Producers take completions from this list in
+    // turn so that each producer's completions are in time order.
+    std::vector<std::size_t> Order (Trace.size ());
+    std::iota (std::begin (Order), std::end (Order), std::size_t{0});
+    std::stable_sort (std::begin (Order), std::end (Order), [&] (std::size_t A, std::size_t B) {
+        return Trace[A].Microseconds < Trace[B].Microseconds;
+    });
+
+    ReplayResult R;
+    R.Completed.resize (Trace.size ());
+    R.Delivered.resize (Trace.size ());
+    Visited V;
+    std::atomic<unsigned> Running{Opts.Producers};
+    R.Start = Clock::now ();
+
+    std::thread Consumer{[&] {
+        while (const std::optional<unsigned> Ordinal = V.next ()) {
+            R.Delivered[*Ordinal] = Clock::now ();
+            std::this_thread::sleep_for (Opts.ConsumerDelay);
+        }
+    }};
+    std::vector<std::thread> Producers;
+    Producers.reserve (Opts.Producers);
+    for (auto P = 0U; P < Opts.Producers; ++P) {
+        Producers.emplace_back ([&, P] {
+            for (auto Index = std::size_t{P}; Index < Order.size (); Index += Opts.Producers) {
+                const TraceRecord & Record = Trace[Order[Index]];
+                std::this_thread::sleep_until (
+                    R.Start + std::chrono::duration_cast<Clock::duration> (
+                                  Micros{static_cast<double> (Record.Microseconds) / Opts.Speed}));
+                R.Completed[Record.Ordinal] = Clock::now ();
+                V.fileCompleted (Record.Ordinal);
+            }
+            if (Running.fetch_sub (1U, std::memory_order_acq_rel) == 1U) {
+                V.done ();
+            }
+        });
+    }
+    for (auto & P : Producers) {
+        P.join ();
+    }
+    Consumer.join ();
+    return R;
+}
+
+// report
+// ~~~~~~
+void report (std::ostream & Os, const std::vector<TraceRecord> & Trace, const ReplayResult & R,
+             const ReplayOptions & Opts) {
+    if (Trace.empty ()) {
+        Os << "The trace is empty.\n";
+        return;
+    }
+    const auto Events = events (R);
+    const auto End = Events.back ().When;
+    const auto WallTime = Millis{End - R.Start};
+
+    // Sweep through the completions and deliveries in time order. The consumer is blocked at the
+    // head of the line when there are completed files waiting but the next file in sequence is
+    // not yet complete.
+    const auto IntervalCount = std::max (Opts.Intervals, 1U);
+    const auto IntervalLength = (End - R.Start) / IntervalCount + Clock::duration{1};
+    // The offset of the start of an interval from the start of the replay.
+    const auto IntervalStart = [IntervalLength] (const std::size_t Index) {
+        return IntervalLength * static_cast<Clock::duration::rep> (Index);
+    };
+    std::vector<Interval> Intervals (IntervalCount);
+    std::vector<bool> IsComplete (Trace.size (), false);
+    auto Depth = 0U;
+    auto Head = 0U;
+    auto HeadOfLine = Clock::duration{0};
+    auto Previous = R.Start;
+    for (const Event & E : Events) {
+        if (Depth > 0U && !IsComplete[Head]) {
+            HeadOfLine += E.When - Previous;
+        }
+        // Attribute the time since the previous event at the current depth to each interval that
+        // it overlaps.
+        for (auto T = Previous; T < E.When;) {
+            const auto Index = static_cast<std::size_t> ((T - R.Start) / IntervalLength);
+            const auto IntervalEnd = R.Start + IntervalStart (Index + 1U);
+            const auto Until = std::min (E.When, IntervalEnd);
+            Intervals[Index].WeightedDepth += Depth * Micros{Until - T}.count ();
+            T = Until;
+        }
+        if (E.IsCompletion) {
+            IsComplete[E.Ordinal] = true;
+            ++Depth;
+        } else {
+            --Depth;
+            Head = E.Ordinal + 1U;
+        }
+        auto & Current =
+            Intervals[static_cast<std::size_t> ((E.When - R.Start) / IntervalLength)];
+        Current.MaxDepth = std::max (Current.MaxDepth, Depth);
+        Previous = E.When;
+    }
+
+    // Latency from fileCompleted() to delivery by next(), overall and for each group.
+    std::vector<double> Latencies;
+    std::map<unsigned, std::vector<double>> GroupLatencies;
+    Latencies.reserve (Trace.size ());
+    for (const TraceRecord & Record : Trace) {
+        const auto L = Micros{R.Delivered[Record.Ordinal] - R.Completed[Record.Ordinal]}.count ();
+        Latencies.push_back (L);
+        GroupLatencies[Record.Group].push_back (L);
+    }
+    std::sort (std::begin (Latencies), std::end (Latencies));
+
+    Os << std::fixed << std::setprecision (1) << "Replayed " << Trace.size () << " files in "
+       << GroupLatencies.size () << " groups with " << Opts.Producers << " producers at "
+       << Opts.Speed << "x speed: " << WallTime.count () << "ms\n"
+       << "Head-of-line blocking: " << Millis{HeadOfLine}.count () << "ms ("
+       << 100.0 * Millis{HeadOfLine}.count () / std::max (WallTime.count (), 1e-9)
+       << "% of wall time)\n"
+       << "Latency from fileCompleted() to next() (us): p50=" << percentile (Latencies, 50.0)
+       << " p90=" << percentile (Latencies, 90.0) << " p99=" << percentile (Latencies, 99.0)
+       << " p99.9=" << percentile (Latencies, 99.9) << " max=" << Latencies.back () << "\n\n";
+
+    Os << std::setw (8) << "group" << std::setw (10) << "files" << std::setw (14) << "p50 (us)"
+       << std::setw (14) << "p99 (us)" << std::setw (14) << "max (us)" << '\n';
+    for (auto & [Group, L] : GroupLatencies) {
+        std::sort (std::begin (L), std::end (L));
+        Os << std::setw (8) << Group << std::setw (10) << L.size () << std::setw (14)
+           << percentile (L, 50.0) << std::setw (14) << percentile (L, 99.0) << std::setw (14)
+           << L.back () << '\n';
+    }
+
+    Os << '\n'
+       << std::setw (12) << "from (ms)" << std::setw (12) << "to (ms)" << std::setw (12)
+       << "mean depth" << std::setw (12) << "max depth" << '\n';
+    for (auto Index = std::size_t{0}; Index < Intervals.size (); ++Index) {
+        Os << std::setw (12) << Millis{IntervalStart (Index)}.count () << std::setw (12)
+           << Millis{IntervalStart (Index + 1U)}.count () << std::setw (12)
+           << Intervals[Index].WeightedDepth / Micros{IntervalLength}.count () << std::setw (12)
+           << Intervals[Index].MaxDepth << '\n';
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+#include "Trace.h"
+
+struct ReplayOptions {
+    /// The number of producer threads among which the trace's completions are shared.
+    unsigned Producers = 8U;
+    /// The rate at which the trace is replayed. 2 replays the trace in half of the original time.
+    double Speed = 1.0;
+    /// Simulated work done by the consumer for each file.
+    std::chrono::microseconds ConsumerDelay{0};
+    /// The number of intervals in the queue depth report.
+    unsigned Intervals = 20U;
+};
+
+/// The times at which each file was completed and delivered during a replay.
+struct ReplayResult {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point Start;
+    /// Indexed by ordinal: the time at which fileCompleted() was called.
+    std::vector<Clock::time_point> Completed;
+    /// Indexed by ordinal: the time at which next() returned the file.
+    std::vector<Clock::time_point> Delivered;
+};
+
+/// Drives a Visited instance with the completions recorded in \p Trace. Each completion is
+/// made by one of Opts.Producers threads at the recorded time (scaled by Opts.Speed); a single
+/// consumer thread takes each file with next().
+ReplayResult replay (const std::vector<TraceRecord> & Trace, const ReplayOptions & Opts);
+
+/// Writes a summary of a replay: the time for which the consumer was blocked at the head of the
+/// line, the latency from fileCompleted() to next() delivery, and the queue depth over time.
+void report (std::ostream & Os, const std::vector<TraceRecord> & Trace, const ReplayResult & R,
+             const ReplayOptions & Opts);
+
+#endif // REPLAY_HPP
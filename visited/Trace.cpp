@@ -0,0 +1,45 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// readTrace
+// ~~~~~~~~~
+std::vector<TraceRecord> readTrace (std::istream & Is) {
+    std::vector<TraceRecord> Records;
+    std::string Line;
+    for (auto LineNumber = 1U; std::getline (Is, Line); ++LineNumber) {
+        const auto First = Line.find_first_not_of (" \t\r");
+        if (First == std::string::npos || Line[First] == '#') {
+            continue;
+        }
+        std::istringstream Fields{Line};
+        TraceRecord R{};
+        if (!(Fields >> R.Ordinal >> R.Group >> R.Microseconds) || !(Fields >> std::ws).eof ()) {
+            throw std::runtime_error{"Malformed trace record at line " +
+                                     std::to_string (LineNumber)};
+        }
+        Records.push_back (R);
+    }
+
+    std::sort (std::begin (Records), std::end (Records),
+               [] (const TraceRecord & A, const TraceRecord & B) { return A.Ordinal < B.Ordinal; });
+    for (auto Index = std::size_t{0}; Index < Records.size (); ++Index) {
+        if (Records[Index].Ordinal != Index) {
+            throw std::runtime_error{"Trace ordinal " + std::to_string (Index) +
+                                     " is missing or duplicated"};
+        }
+    }
+    return Records;
+}
+
+// writeTrace
+// ~~~~~~~~~~
+void writeTrace (std::ostream & Os, const std::vector<TraceRecord> & Records) {
+    Os << "# ordinal group microseconds\n";
+    for (const TraceRecord & R : Records) {
+        Os << R.Ordinal << ' ' << R.Group << ' ' << R.Microseconds << '\n';
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/// A record of the completion of one file by symbol resolution.
+struct TraceRecord {
+    unsigned Ordinal;
+    /// The symbol resolution group to which the file belonged.
+    unsigned Group;
+    /// The time at which the file was completed, in microseconds from the start of the link.
+    std::uint64_t Microseconds;
+};
+
+/// Reads a trace. The trace is text with one record per line: the ordinal, group, and
+/// completion time separated by white space. Blank lines and lines starting with '#' are ignored.
+/// \returns The records ordered by ordinal.
+/// \throws std::runtime_error if a record is malformed or the ordinals are not exactly
+///   [0, number of records).
+std::vector<TraceRecord> readTrace (std::istream & Is);
+
+/// Writes a trace in the format accepted by readTrace().
+void writeTrace (std::ostream & Os, const std::vector<TraceRecord> & Records);
+
+#endif // TRACE_HPP
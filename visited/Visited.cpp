@@ -1,53 +1,246 @@
 #include "Visited.h"
 
+#include <algorithm>
 #include <cassert>
 
+#ifdef _MSC_VER
+#    include <intrin.h>
+#endif
+
+namespace {
+
+    /// Returns the number of consecutive 1 bits in \p W starting at the least significant bit.
+    unsigned countTrailingOnes (const std::uint64_t W) noexcept {
+        const auto Inverted = ~W;
+        if (Inverted == 0U) {
+            return 64U;
+        }
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned> (__builtin_ctzll (Inverted));
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long Index;
+        _BitScanForward64 (&Index, Inverted);
+        return static_cast<unsigned> (Index);
+#else
+        auto Result = 0U;
+        for (auto X = Inverted; (X & 1U) == 0U; X >>= 1U) {
+            ++Result;
+        }
+        return Result;
+#endif
+    }
+
+} // end anonymous namespace
+
+// (ctor)
+// ~~~~~~
+Visited::Visited ()
+        : Directory_{new std::atomic<Chunk *>[DirectorySize] ()} {}
+
+// (dtor)
+// ~~~~~~
+Visited::~Visited () noexcept {
+    for (auto Index = std::uint64_t{0}; Index < DirectorySize; ++Index) {
+        delete Directory_[Index].load (std::memory_order_relaxed);
+    }
+}
+
+// producer word
+// ~~~~~~~~~~~~~
+std::atomic<Visited::Word> & Visited::producerWord (const unsigned Ordinal) {
+    std::atomic<Chunk *> & Slot = Directory_[Ordinal / ChunkBits];
+    Chunk * C = Slot.load (std::memory_order_seq_cst);
+    if (C == nullptr) {
+        // This is the first ordinal to be completed in this chunk. Allocate it and race with any
+        // other producer doing the same.
+        auto Fresh = std::make_unique<Chunk> ();
+        if (Slot.compare_exchange_strong (C, Fresh.get (), std::memory_order_seq_cst)) {
+            C = Fresh.release ();
+        }
+    }
+    return C->Words[(Ordinal % ChunkBits) / WordBits];
+}
+
+// is ready
+// ~~~~~~~~
+bool Visited::isReady (const unsigned Ordinal, const std::memory_order Order) const noexcept {
+    const Chunk * const C = Directory_[Ordinal / ChunkBits].load (Order);
+    return C != nullptr && (C->Words[(Ordinal % ChunkBits) / WordBits].load (Order) &
+                            (Word{1} << (Ordinal % WordBits))) != 0U;
+}
+
+// wake
+// ~~~~
+void Visited::wake (const unsigned First, const unsigned Last) {
+    // The bits for [First, Last) were set by sequentially consistent operations. If the consumer
+    // published its intent to wait for one of these ordinals before that operation, we must wake
+    // it; otherwise it is guaranteed to see the bit when it re-checks before blocking.
+    const auto Awaiting = Awaiting_.load (std::memory_order_seq_cst);
+    if (Awaiting >= First && Awaiting < Last) {
+        const std::lock_guard<decltype (Mut_)> _{Mut_};
+        CV_.notify_one ();
+    }
+}
+
 // file completed
 // ~~~~~~~~~~~~~~
 void Visited::fileCompleted (const unsigned Ordinal) {
-    const std::lock_guard<decltype (Mut_)> _{Mut_};
-    assert (!Done_ && "Must not call fileCompleted() after done()");
-    assert (Visited_.insert (Ordinal).second && "O must not have been previously visted");
-    Waiting_.push (Ordinal);
-    CV_.notify_one ();
+    assert (!Done_.load (std::memory_order_relaxed) &&
+            "Must not call fileCompleted() after done()");
+    assert (Ordinal != NotWaiting && "Ordinal is out of range");
+    const auto Bit = Word{1} << (Ordinal % WordBits);
+    [[maybe_unused]] const auto Prev =
+        this->producerWord (Ordinal).fetch_or (Bit, std::memory_order_seq_cst);
+    assert ((Prev & Bit) == 0U && "O must not have been previously visted");
+    this->wake (Ordinal, Ordinal + 1U);
 }
 
-// next
-// ~~~~
-std::optional<unsigned> Visited::next () {
-    std::unique_lock<decltype (Mut_)> Lock{Mut_};
-    for (;;) {
-        const auto IsEmpty = Waiting_.empty ();
-        if ((Done_ && IsEmpty) || Error_) {
-            return std::nullopt;
-        }
-        if (!IsEmpty && Waiting_.top () == ConsumerOrdinal_) {
-            Waiting_.pop ();
-            return {ConsumerOrdinal_++};
-        }
-        CV_.wait (Lock);
+// file completed range
+// ~~~~~~~~~~~~~~~~~~~~
+void Visited::fileCompletedRange (const unsigned First, const unsigned Last) {
+    assert (!Done_.load (std::memory_order_relaxed) &&
+            "Must not call fileCompletedRange() after done()");
+    assert (First <= Last && Last != NotWaiting && "Ordinal range is invalid");
+    for (auto Ordinal = First; Ordinal < Last;) {
+        // Set as many bits as lie within the range in the word containing Ordinal.
+        const auto Shift = Ordinal % WordBits;
+        const auto Count = std::min (WordBits - Shift, Last - Ordinal);
+        const auto Bits = (Count == WordBits ? ~Word{0} : (Word{1} << Count) - 1U) << Shift;
+        [[maybe_unused]] const auto Prev =
+            this->producerWord (Ordinal).fetch_or (Bits, std::memory_order_seq_cst);
+        assert ((Prev & Bits) == 0U && "O must not have been previously visted");
+        Ordinal += Count;
     }
+    this->wake (First, Last);
 }
 
 // done
 // ~~~~
 void Visited::done () {
+    Done_.store (true, std::memory_order_seq_cst);
     const std::lock_guard<decltype (Mut_)> _{Mut_};
-    Done_ = true;
     CV_.notify_all ();
 }
 
 // error
 // ~~~~~
 void Visited::error () {
+    Error_.store (true, std::memory_order_seq_cst);
     const std::lock_guard<decltype (Mut_)> _{Mut_};
-    Error_ = true;
     CV_.notify_all ();
 }
 
+// ready run
+// ~~~~~~~~~
+unsigned Visited::readyRun (const unsigned Max) const noexcept {
+    auto Run = 0U;
+    while (Run < Max) {
+        const auto Ordinal = ConsumerOrdinal_ + Run;
+        const Chunk * const C = Directory_[Ordinal / ChunkBits].load (std::memory_order_acquire);
+        if (C == nullptr) {
+            break;
+        }
+        const auto Shift = Ordinal % WordBits;
+        const auto Ones = countTrailingOnes (
+            C->Words[(Ordinal % ChunkBits) / WordBits].load (std::memory_order_acquire) >> Shift);
+        Run += Ones;
+        if (Ones < WordBits - Shift) {
+            break; // This word contains the end of the run.
+        }
+    }
+    return std::min (Run, Max);
+}
+
+// advance
+// ~~~~~~~
+auto Visited::advance (const unsigned Count) -> Range {
+    const auto First = ConsumerOrdinal_;
+    ConsumerOrdinal_ += Count;
+    // Every ordinal in the chunks that the cursor has left has now been handed to the consumer so
+    // no producer can touch them again.
+    for (auto Index = First / ChunkBits; Index < ConsumerOrdinal_ / ChunkBits; ++Index) {
+        delete Directory_[Index].exchange (nullptr, std::memory_order_relaxed);
+    }
+    return {First, ConsumerOrdinal_};
+}
+
+// try next range
+// ~~~~~~~~~~~~~~
+auto Visited::tryNextRange (const unsigned Max) -> std::optional<Range> {
+    assert (Max > 0U && "Max must be at least 1");
+    if (Error_.load (std::memory_order_acquire)) {
+        return std::nullopt;
+    }
+    if (const auto Run = this->readyRun (Max)) {
+        return {this->advance (Run)};
+    }
+    if (Done_.load (std::memory_order_acquire)) {
+        // Every call to fileCompleted() happens before done(), so this check is final.
+        if (const auto Run = this->readyRun (Max)) {
+            return {this->advance (Run)};
+        }
+        Finished_.store (true, std::memory_order_relaxed);
+    }
+    return std::nullopt;
+}
+
+// try next
+// ~~~~~~~~
+std::optional<unsigned> Visited::tryNext () {
+    return first (this->tryNextRange (1U));
+}
+
+// next
+// ~~~~
+std::optional<unsigned> Visited::next () {
+    return first (this->nextImpl (1U, nullptr));
+}
+
+// next range
+// ~~~~~~~~~~
+auto Visited::nextRange (const unsigned Max) -> std::optional<Range> {
+    return this->nextImpl (Max, nullptr);
+}
+
+// next impl
+// ~~~~~~~~~
+auto Visited::nextImpl (const unsigned Max, const Deadline * const D) -> std::optional<Range> {
+    for (;;) {
+        if (const auto R = this->tryNextRange (Max)) {
+            return R;
+        }
+        if (this->isFinished ()) {
+            return std::nullopt;
+        }
+
+        std::unique_lock<decltype (Mut_)> Lock{Mut_};
+        Awaiting_.store (ConsumerOrdinal_, std::memory_order_seq_cst);
+        const auto Wake = [this] {
+            return this->isReady (ConsumerOrdinal_, std::memory_order_seq_cst) ||
+                   Done_.load (std::memory_order_seq_cst) ||
+                   Error_.load (std::memory_order_seq_cst);
+        };
+        auto TimedOut = false;
+        if (D == nullptr) {
+            CV_.wait (Lock, Wake);
+        } else {
+            TimedOut = !CV_.wait_until (Lock, *D, Wake);
+        }
+        Awaiting_.store (NotWaiting, std::memory_order_relaxed);
+        if (TimedOut) {
+            return std::nullopt;
+        }
+    }
+}
+
+// is finished
+// ~~~~~~~~~~~
+bool Visited::isFinished () const {
+    return Error_.load (std::memory_order_acquire) || Finished_.load (std::memory_order_relaxed);
+}
+
 // has error
 // ~~~~~~~~~
 bool Visited::hasError () const {
-    const std::lock_guard<decltype (Mut_)> _{Mut_};
-    return Error_;
+    return Error_.load (std::memory_order_acquire);
 }
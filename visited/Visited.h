@@ -1,22 +1,50 @@
 #ifndef VISITED_HPP
 #define VISITED_HPP
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <optional>
-#include <queue>
-#include <unordered_set>
-#include <vector>
 
+/// Visited is the sequencer which sits between symbol resolution (the producers) and layout (the
+/// consumer). Producers may complete files in any order; the consumer receives their ordinals
+/// strictly in sequence.
+///
+/// The ready state of each ordinal is a single bit in a two-level bitmap. Producers set a bit with
+/// one atomic operation and only touch the mutex if the consumer is asleep waiting for that exact
+/// ordinal. The consumer walks the bitmap with a cursor and releases each chunk of the bitmap once
+/// the cursor has moved beyond it. Only a single consumer thread is supported.
 class Visited {
 public:
-    Visited () = default;
+    /// A half-open range of file ordinals [First, Last).
+    struct Range {
+        unsigned First;
+        unsigned Last;
+
+        constexpr unsigned size () const noexcept { return Last - First; }
+    };
+
+    Visited ();
+    Visited (const Visited &) = delete;
+    Visited (Visited &&) = delete;
+    ~Visited () noexcept;
+
+    Visited & operator= (const Visited &) = delete;
+    Visited & operator= (Visited &&) = delete;
 
     ///@{
     /// Producer API.
 
     /// Marks the file with the given ordinal as ready for layout.
     void fileCompleted (unsigned Ordinal);
+    /// Marks the files with ordinals in the range [First, Last) as ready for layout. This is
+    /// equivalent to calling fileCompleted() for each ordinal in the range but sets up to 64 bits
+    /// with each atomic operation and wakes the consumer at most once.
+    void fileCompletedRange (unsigned First, unsigned Last);
     /// Signals that the last input from the last group has been completed. Wakes up any waiting
     /// threads.
     void done ();
@@ -31,25 +59,90 @@ public:
     /// \returns Has the next ordinal value on success. If the optional<> has no value, either there
     /// was an error or the last file ordinal was already returned.
     std::optional<unsigned> next ();
+    /// Blocks until at least the next input is available.
+    /// \param Max  The maximum number of ordinals to return. Must be at least 1.
+    /// \returns On success, the longest contiguous run of ready files [ConsumerOrdinal_, k)
+    ///   containing no more than \p Max ordinals. If the optional<> has no value, either there was
+    ///   an error or the last file ordinal was already returned.
+    std::optional<Range> nextRange (unsigned Max);
+    /// Returns the next ordinal if it is ready without blocking. If the optional<> has no value,
+    /// either the next file is not yet ready, there was an error, or the last file ordinal was
+    /// already returned. Use isFinished() to distinguish these cases.
+    std::optional<unsigned> tryNext ();
+    /// Blocks until the next input is available or the timeout expires.
+    /// \returns As next(). Additionally, the optional<> has no value if the timeout expired.
+    template <typename Rep, typename Period>
+    std::optional<unsigned> nextFor (const std::chrono::duration<Rep, Period> & Timeout) {
+        return this->nextUntil (std::chrono::steady_clock::now () + Timeout);
+    }
+    /// Blocks until the next input is available or the deadline passes.
+    /// \returns As next(). Additionally, the optional<> has no value if the deadline passed.
+    std::optional<unsigned> nextUntil (const std::chrono::steady_clock::time_point Until) {
+        return first (this->nextImpl (1U, &Until));
+    }
+    /// Returns true if there was an error or if the last file ordinal was already returned. Once
+    /// this function returns true, next() will never produce another value.
+    bool isFinished () const;
     ///@}
 
     /// Returns true if an error was signalled via a call to error().
     bool hasError () const;
 
 private:
-    /// Mutex synchonizes access to members of this instance.
-    mutable std::mutex Mut_;
-    /// Synchonizes producer (symbol resolution) and consumer (layout) threads.
+    using Word = std::uint64_t;
+    static constexpr auto WordBits = unsigned{std::numeric_limits<Word>::digits};
+    /// The number of bits in each chunk of the bitmap (2^18 ordinals: 32KiB per chunk).
+    static constexpr auto ChunkBits = 1U << 18U;
+    static constexpr auto WordsPerChunk = ChunkBits / WordBits;
+    /// The number of chunks needed to cover every possible ordinal value.
+    static constexpr auto DirectorySize =
+        (std::uint64_t{std::numeric_limits<unsigned>::max ()} + 1U) / ChunkBits;
+    /// The value of Awaiting_ when the consumer is not blocked.
+    static constexpr auto NotWaiting = std::numeric_limits<unsigned>::max ();
+
+    struct Chunk {
+        std::atomic<Word> Words[WordsPerChunk];
+    };
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    static std::optional<unsigned> first (const std::optional<Range> & R) {
+        return R ? std::optional<unsigned>{R->First} : std::nullopt;
+    }
+
+    /// Returns the bitmap word containing the bit for \p Ordinal, allocating the enclosing chunk
+    /// if necessary.
+    std::atomic<Word> & producerWord (unsigned Ordinal);
+    /// Returns true if the bit for \p Ordinal is set.
+    bool isReady (unsigned Ordinal, std::memory_order Order) const noexcept;
+    /// Returns the number of consecutive ready ordinals starting at the consumer's cursor, up to
+    /// a maximum of \p Max.
+    unsigned readyRun (unsigned Max) const noexcept;
+    /// Hands out \p Count ordinals starting at the consumer's cursor and advances the cursor.
+    Range advance (unsigned Count);
+    /// Hands out up to \p Max ready ordinals without blocking.
+    std::optional<Range> tryNextRange (unsigned Max);
+    /// Implements next(), nextRange() and nextUntil(). Blocks until the next input is available,
+    /// there are no more inputs, or (if \p D is not null) the deadline passes.
+    std::optional<Range> nextImpl (unsigned Max, const Deadline * D);
+    /// Wakes the consumer if it is blocked waiting for an ordinal in [First, Last).
+    void wake (unsigned First, unsigned Last);
+
+    /// A directory of chunks each of which holds ChunkBits ready bits. Chunks are allocated on
+    /// demand by producers and released by the consumer.
+    std::unique_ptr<std::atomic<Chunk *>[]> Directory_;
+
+    /// Mutex and condition variable used only to block and wake the consumer thread.
+    std::mutex Mut_;
     std::condition_variable CV_;
+    /// The ordinal for which the consumer is blocked or NotWaiting.
+    std::atomic<unsigned> Awaiting_{NotWaiting};
 
-    /// An ordered collection of the files ready for processing by layout.
-    std::priority_queue<unsigned, std::vector<unsigned>, std::greater<unsigned>> Waiting_;
-#ifndef NDEBUG
-    std::unordered_set<unsigned> Visited_;
-#endif // NDEBUG
+    /// The ordinal of the next file to be handed to the consumer. Accessed only by the consumer.
     unsigned ConsumerOrdinal_ = 0U;
-    bool Done_ = false;
-    bool Error_ = false;
+    std::atomic<bool> Done_{false};
+    std::atomic<bool> Error_{false};
+    /// Set once the consumer has seen done() and an empty cursor.
+    std::atomic<bool> Finished_{false};
 };
 
 #endif // VISITED_HPP
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CompletionOrder.h"
+#include "LockingVisited.h"
+#include "Visited.h"
+
+namespace {
+
+    using OrdinalRange = std::pair<unsigned, unsigned>;
+
+    // Adapters which present a common producer/consumer interface for both sequencers.
+    void complete (LockingVisited & V, const OrdinalRange & R) {
+        for (auto Ordinal = R.first; Ordinal < R.second; ++Ordinal) {
+            V.fileCompleted (Ordinal);
+        }
+    }
+    void complete (Visited & V, const OrdinalRange & R) {
+        if (R.second - R.first == 1U) {
+            V.fileCompleted (R.first);
+        } else {
+            V.fileCompletedRange (R.first, R.second);
+        }
+    }
+    std::optional<OrdinalRange> take (LockingVisited & V, const unsigned /*Max*/) {
+        if (const auto Ordinal = V.next ()) {
+            return OrdinalRange{*Ordinal, *Ordinal + 1U};
+        }
+        return std::nullopt;
+    }
+    std::optional<OrdinalRange> take (Visited & V, const unsigned Max) {
+        if (Max == 1U) {
+            if (const auto Ordinal = V.next ()) {
+                return OrdinalRange{*Ordinal, *Ordinal + 1U};
+            }
+        } else if (const auto R = V.nextRange (Max)) {
+            return OrdinalRange{R->First, R->Last};
+        }
+        return std::nullopt;
+    }
+
+    struct Result {
+        std::chrono::duration<double> Elapsed;
+        unsigned Batches;
+    };
+
+    // Runs a single producers/consumer trial. Each producer completes ProducerBatch consecutive
+    // ordinals at a time; the consumer takes up to ConsumerBatch ordinals at a time.
+    template <typename Sequencer>
+    Result trial (const unsigned Files, const unsigned Producers, const unsigned ProducerBatch,
+                  const unsigned ConsumerBatch) {
+        const auto Order = completionOrder (Files / ProducerBatch);
+        Sequencer V;
+        std::atomic<std::size_t> Index{0};
+        const auto Start = std::chrono::steady_clock::now ();
+
+        std::vector<std::thread> Threads;
+        Threads.reserve (Producers);
+        for (auto P = 0U; P < Producers; ++P) {
+            Threads.emplace_back ([&] {
+                for (;;) {
+                    const auto I = Index.fetch_add (1U, std::memory_order_relaxed);
+                    if (I >= Order.size ()) {
+                        break;
+                    }
+                    const auto First = Order[I] * ProducerBatch;
+                    complete (V, OrdinalRange{First, First + ProducerBatch});
+                }
+            });
+        }
+        auto Expected = 0U;
+        auto Batches = 0U;
+        std::thread Consumer{[&] {
+            while (const std::optional<OrdinalRange> R = take (V, ConsumerBatch)) {
+                if (R->first != Expected) {
+                    std::cerr << "Out of sequence ordinal " << R->first << '\n';
+                    std::exit (EXIT_FAILURE);
+                }
+                Expected = R->second;
+                ++Batches;
+            }
+        }};
+        for (auto & T : Threads) {
+            T.join ();
+        }
+        V.done ();
+        Consumer.join ();
+        return {std::chrono::steady_clock::now () - Start, Batches};
+    }
+
+    template <typename Sequencer>
+    void run (const char * const Name, unsigned Files, const unsigned Producers,
+              const unsigned ProducerBatch = 1U, const unsigned ConsumerBatch = 1U) {
+        Files -= Files % ProducerBatch;
+        const auto R = trial<Sequencer> (Files, Producers, ProducerBatch, ConsumerBatch);
+        std::cout << std::left << std::setw (18) << Name << std::right << std::setw (10)
+                  << Producers << std::setw (12) << Files << std::setw (10) << R.Batches
+                  << std::setw (14) << std::fixed << std::setprecision (6) << R.Elapsed.count ()
+                  << std::setw (16) << std::setprecision (0)
+                  << static_cast<double> (Files) / R.Elapsed.count () << '\n';
+    }
+
+} // end anonymous namespace
+
+// Measures the throughput of Visited against the original LockingVisited with out-of-order
+// producers and a single in-order consumer. The "range" rows use fileCompletedRange() to
+// complete blocks of 16 files and nextRange() to consume up to 512 files at a time.
+//
+// Usage: rld-visited-bench [files]
+int main (int argc, char ** argv) {
+    const auto Files = argc > 1 ? static_cast<unsigned> (std::stoul (argv[1])) : 1'048'576U;
+    const auto MaxProducers = std::max (std::thread::hardware_concurrency (), 2U);
+
+    std::cout << std::left << std::setw (18) << "class" << std::right << std::setw (10)
+              << "producers" << std::setw (12) << "files" << std::setw (10) << "batches"
+              << std::setw (14) << "seconds" << std::setw (16) << "files/sec" << '\n';
+    for (auto Producers = 1U; Producers <= MaxProducers; Producers *= 2U) {
+        run<LockingVisited> ("LockingVisited", Files, Producers);
+        run<Visited> ("Visited", Files, Producers);
+        run<Visited> ("Visited (range)", Files, Producers, 16U, 512U);
+    }
+}
@@ -1,11 +1,18 @@
 #include <cassert>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <numeric>
+#include <optional>
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <thread>
 
+#include "Replay.h"
+#include "Trace.h"
 #include "Visited.h"
 
 using namespace std::chrono_literals;
@@ -60,10 +67,79 @@ namespace {
         }
     }
 
+    bool startsWith (const std::string & S, const std::string & Prefix) {
+        return S.compare (0, Prefix.length (), Prefix) == 0;
+    }
+
+    struct Options {
+        /// The trace to be replayed. If empty, the built-in simulation is run.
+        std::string TracePath;
+        ReplayOptions Replay;
+    };
+
+    std::optional<Options> parseOptions (const int Argc, const char * const * const Argv) {
+        Options Opts;
+        for (auto Arg = 1; Arg < Argc; ++Arg) {
+            const std::string A = Argv[Arg];
+            if (startsWith (A, "--replay=")) {
+                Opts.TracePath = A.substr (9);
+            } else if (startsWith (A, "--producers=")) {
+                Opts.Replay.Producers = static_cast<unsigned> (std::stoul (A.substr (12)));
+            } else if (startsWith (A, "--speed=")) {
+                Opts.Replay.Speed = std::stod (A.substr (8));
+            } else if (startsWith (A, "--consumer-delay=")) {
+                Opts.Replay.ConsumerDelay = std::chrono::microseconds{std::stoll (A.substr (17))};
+            } else if (startsWith (A, "--intervals=")) {
+                Opts.Replay.Intervals = static_cast<unsigned> (std::stoul (A.substr (12)));
+            } else {
+                return std::nullopt;
+            }
+        }
+        if (Opts.Replay.Producers == 0U || Opts.Replay.Speed <= 0.0) {
+            return std::nullopt;
+        }
+        return Opts;
+    }
+
+    void usage (const char * const Argv0) {
+        std::cerr << "Usage: " << Argv0 << " [options]\n"
+                  << "  --replay=<file>          Replay a trace of file completions\n"
+                  << "  --producers=<n>          The number of producer threads (default 8)\n"
+                  << "  --speed=<x>              Replay speed relative to the trace (default 1)\n"
+                  << "  --consumer-delay=<us>    Simulated consumer work for each file\n"
+                  << "  --intervals=<n>          Rows in the queue depth report (default 20)\n"
+                  << "Without --replay, runs a simulation of three groups of files.\n";
+    }
+
+    int replayTrace (const Options & Opts) {
+        std::ifstream Is{Opts.TracePath};
+        if (!Is) {
+            std::cerr << "Error: could not open " << Opts.TracePath << '\n';
+            return EXIT_FAILURE;
+        }
+        const std::vector<TraceRecord> Trace = readTrace (Is);
+        report (std::cout, Trace, replay (Trace, Opts.Replay), Opts.Replay);
+        return EXIT_SUCCESS;
+    }
+
 } // end anonymous namespace
 
-// The expected output consists of integers in order from 0 to 60.
-int main () {
+// Without options, the expected output consists of integers in order from 0 to 60.
+int main (int argc, char ** argv) {
+    const std::optional<Options> Opts = parseOptions (argc, argv);
+    if (!Opts) {
+        usage (argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!Opts->TracePath.empty ()) {
+        try {
+            return replayTrace (*Opts);
+        } catch (const std::exception & Ex) {
+            std::cerr << "Error: " << Ex.what () << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+
     Visited V;
     // The number of groups, and the maximum file index within each of them is defined by the
     // container passed as the producer's second argument. The group container passed to the